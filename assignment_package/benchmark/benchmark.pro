@@ -0,0 +1,53 @@
+# Console benchmarks for the terrain generation code.
+# Build and run this separately from the game, e.g.
+#   qmake benchmark.pro && make && ./MiniMinecraftBenchmark [benchmark names...]
+# Chunk derives from Drawable, so we link against the OpenGL classes
+# even though no context is ever created
+QT += widgets openglwidgets
+
+TARGET = MiniMinecraftBenchmark
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+CONFIG += c++1z
+# Timings from a debug build say nothing about the real game
+CONFIG += release
+
+INCLUDEPATH += ../include ../src
+
+SOURCES += \
+    main.cpp \
+    ../src/drawable.cpp \
+    ../src/scene/cavefield.cpp \
+    ../src/scene/chunk.cpp \
+    ../src/scene/chunkdirectory.cpp \
+    ../src/scene/chunkmap.cpp \
+    ../src/scene/chunkpool.cpp \
+    ../src/scene/decorator.cpp \
+    ../src/scene/generationpipeline.cpp \
+    ../src/scene/noise.cpp \
+    ../src/scene/noisebatch.cpp \
+    ../src/scene/palettedblocks.cpp \
+    ../src/scene/stageworker.cpp \
+    ../src/scene/worldfile.cpp \
+    ../src/scene/zonemap.cpp
+
+HEADERS += \
+    ../src/drawable.h \
+    ../src/scene/blocklayout.h \
+    ../src/scene/blockregistry.h \
+    ../src/scene/cavefield.h \
+    ../src/scene/chunk.h \
+    ../src/scene/chunkdirectory.h \
+    ../src/scene/chunkmap.h \
+    ../src/scene/chunkpool.h \
+    ../src/scene/decorator.h \
+    ../src/scene/generationpipeline.h \
+    ../src/scene/noise.h \
+    ../src/scene/noisegraph.h \
+    ../src/scene/noisekernel.inl \
+    ../src/scene/palettedblocks.h \
+    ../src/scene/stageworker.h \
+    ../src/scene/terrainnoise.h \
+    ../src/scene/worldfile.h \
+    ../src/scene/zonemap.h
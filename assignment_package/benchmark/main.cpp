@@ -0,0 +1,1790 @@
+#include "scene/cavefield.h"
+#include "scene/chunk.h"
+#include "scene/chunkdirectory.h"
+#include "scene/chunkmap.h"
+#include "scene/chunkpool.h"
+#include "scene/decorator.h"
+#include "scene/generationpipeline.h"
+#include "scene/noise.h"
+#include "scene/worldfile.h"
+#include "scene/zonemap.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bitset>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <new>
+#include <vector>
+
+// Bytes and blocks handed out by operator new, so benchmarks can
+// measure how much heap memory building an object costs.
+// GCC cannot tell that our operator delete pairs with our operator new.
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+static std::atomic<size_t> g_heapBytes(0);
+static std::atomic<size_t> g_heapAllocs(0);
+
+void* operator new(size_t size) {
+    g_heapBytes += size;
+    g_heapAllocs++;
+    if(void *p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    std::free(p);
+}
+
+// Runs fn repeatedly for at least minSeconds and returns the average
+// wall-clock seconds per call.
+static double timeIt(const std::function<void()> &fn, double minSeconds = 0.5) {
+    using clock = std::chrono::steady_clock;
+    fn(); // warm up caches and lazy statics
+    int calls = 0;
+    auto start = clock::now();
+    double elapsed = 0.0;
+    do {
+        fn();
+        calls++;
+        elapsed = std::chrono::duration<double>(clock::now() - start).count();
+    } while(elapsed < minSeconds);
+    return elapsed / calls;
+}
+
+// Columns/sec of batchColumnNoise at every SimdLevel this machine supports,
+// compared against the scalar Height() and Moisture() functions.
+static void benchColumnNoise() {
+    // Eight 64 x 64 zones scattered from the origin out to far-away coordinates
+    const std::vector<glm::ivec2> zones = {
+        {0, 0}, {64, -128}, {-4096, 2048}, {30016, 30016},
+        {-250048, 99968}, {1000000, -1000000}, {512, 512}, {-64, -64}
+    };
+    const int count = 64 * 64 * static_cast<int>(zones.size());
+    std::vector<float> worldX, worldZ;
+    for(const glm::ivec2 &zone : zones) {
+        for(int z = 0; z < 64; z++) {
+            for(int x = 0; x < 64; x++) {
+                worldX.push_back(zone.x + x);
+                worldZ.push_back(zone.y + z);
+            }
+        }
+    }
+
+    std::vector<float> refHeight(count), refMoisture(count);
+    batchColumnNoise(worldX.data(), worldZ.data(), refHeight.data(), refMoisture.data(), count, SimdLevel::Scalar);
+
+    std::cout << "column noise (" << count << " columns, best level " << simdLevelName(bestSimdLevel()) << ")\n";
+    double scalarTime = 0.0;
+    for(SimdLevel level : {SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2}) {
+        if(level > bestSimdLevel()) {
+            continue;
+        }
+        std::vector<float> height(count), moisture(count);
+        double t = timeIt([&]() {
+            batchColumnNoise(worldX.data(), worldZ.data(), height.data(), moisture.data(), count, level);
+        });
+        if(level == SimdLevel::Scalar) {
+            scalarTime = t;
+        }
+
+        float maxHeightError = 0.f, maxMoistureError = 0.f;
+        int blockMismatches = 0;
+        for(int i = 0; i < count; i++) {
+            maxHeightError = std::max(maxHeightError, std::abs(height[i] - refHeight[i]));
+            maxMoistureError = std::max(maxMoistureError, std::abs(moisture[i] - refMoisture[i]));
+            // GenerateChunkAt truncates the height to a block index
+            if(static_cast<int>(height[i]) != static_cast<int>(refHeight[i])) {
+                blockMismatches++;
+            }
+        }
+        std::cout << "  " << simdLevelName(level) << ": "
+                  << static_cast<long long>(count / t) << " columns/sec, "
+                  << scalarTime / t << "x scalar, max height error " << maxHeightError
+                  << ", max moisture error " << maxMoistureError
+                  << ", columns with a different top block " << blockMismatches << "\n";
+    }
+}
+
+static const char* noiseHashName(NoiseHash hash) {
+    return hash == NoiseHash::Integer ? "integer" : "sin/fract";
+}
+
+// A checksum of noise2D() over a strip of lattice points starting at x,
+// used to check that every thread (and every platform) sees the same values
+static uint32_t noiseChecksum(float x, int count) {
+    uint32_t sum = 2166136261u;
+    for(int i = 0; i < count; i++) {
+        float v = noise2D(glm::vec2(x + i, 7.f));
+        uint32_t bits;
+        std::memcpy(&bits, &v, sizeof(bits));
+        sum = (sum ^ bits) * 16777619u;
+    }
+    return sum;
+}
+
+// The sin/fract hash against the seeded integer hash: raw hash throughput,
+// the cost of the noise functions built on top of it, and how many distinct
+// values each hash still produces far away from the origin.
+static void benchNoiseHash() {
+    const NoiseBackend original = noiseBackend();
+    const int count = 1 << 16;
+    std::vector<glm::vec2> lattice(count);
+    std::vector<glm::vec3> points(count);
+    for(int i = 0; i < count; i++) {
+        lattice[i] = glm::vec2(i % 256 - 128, i / 256 - 128);
+        points[i] = glm::vec3(i % 64, (i / 64) % 32, i / 2048) * 0.37f;
+    }
+
+    std::cout << "noise hash (" << count << " calls per measurement)\n";
+    for(NoiseHash hash : {NoiseHash::SinFract, NoiseHash::Integer}) {
+        setNoiseBackend({hash, 1337});
+        float sink = 0.f;
+        auto nsPerCall = [&](const std::function<void()> &fn) {
+            return timeIt(fn, 0.25) * 1e9 / count;
+        };
+        double tNoise = nsPerCall([&]() {
+            for(const glm::vec2 &p : lattice) sink += noise2D(p);
+        });
+        double tRandom2 = nsPerCall([&]() {
+            for(const glm::vec2 &p : lattice) sink += random2(p).x;
+        });
+        double tFbm = nsPerCall([&]() {
+            for(const glm::vec2 &p : lattice) sink += fbm(p.x / 256.f, p.y / 256.f);
+        });
+        double tWorley = nsPerCall([&]() {
+            for(const glm::vec2 &p : lattice) sink += WorleyNoise(p / 64.f);
+        });
+        double tPerlin = nsPerCall([&]() {
+            for(const glm::vec3 &p : points) sink += perlinNoise3D(p);
+        });
+        std::cout << "  " << noiseHashName(hash) << ": noise2D " << tNoise << " ns, random2 " << tRandom2
+                  << " ns, fbm " << tFbm << " ns, WorleyNoise " << tWorley
+                  << " ns, perlinNoise3D " << tPerlin << " ns (sum " << sink << ")\n";
+
+        // Float holds every integer up to 2^24 exactly, so every one of these
+        // lattice points is distinct and should get its own value
+        std::cout << "    distinct noise2D values in 4096 neighbouring lattice points:";
+        for(float origin : {0.f, 1e5f, 1e6f, 1e7f}) {
+            std::set<float> values;
+            for(int i = 0; i < 4096; i++) {
+                values.insert(noise2D(glm::vec2(origin + i, origin)));
+            }
+            std::cout << " " << static_cast<long long>(origin) << ": " << values.size();
+        }
+        std::cout << "\n";
+
+        const uint32_t expected = noiseChecksum(1e7f, 4096);
+        int mismatches = 0;
+        std::vector<std::thread> threads;
+        std::vector<uint32_t> results(8);
+        for(size_t t = 0; t < results.size(); t++) {
+            threads.emplace_back([&results, t]() { results[t] = noiseChecksum(1e7f, 4096); });
+        }
+        for(std::thread &t : threads) {
+            t.join();
+        }
+        for(uint32_t r : results) {
+            mismatches += r != expected;
+        }
+        std::cout << "    checksum near 1e7 " << std::hex << expected << std::dec
+                  << ", threads disagreeing " << mismatches << " of " << results.size() << "\n";
+    }
+    setNoiseBackend(original);
+}
+
+// Cost per Chunk of the cave density field: sampling the coarse lattice,
+// upsampling it to every voxel up to CaveField::TOP, and what evaluating
+// perlinNoise3D at every one of those voxels would cost instead.
+static void benchCaves() {
+    const int chunks = 64;
+    const int voxels = 16 * 16 * CaveField::TOP;
+    std::vector<glm::ivec2> positions;
+    for(int i = 0; i < chunks; i++) {
+        positions.push_back(glm::ivec2((i % 8) * 16 - 64, (i / 8) * 16 + 4096));
+    }
+
+    float sink = 0.f;
+    double tLattice = timeIt([&]() {
+        for(const glm::ivec2 &p : positions) {
+            CaveField field(p);
+            sink += field.isCave(0.f);
+        }
+    }) / chunks;
+    int caveVoxels = 0;
+    double tTotal = timeIt([&]() {
+        caveVoxels = 0;
+        float density[256];
+        for(const glm::ivec2 &p : positions) {
+            CaveField field(p);
+            for(int y = 1; y <= CaveField::TOP; y++) {
+                field.layer(y, density);
+                for(float d : density) {
+                    caveVoxels += CaveField::isCave(d);
+                }
+            }
+        }
+    }) / chunks;
+    // Far too slow to run for a whole Chunk, so time one column of voxels
+    double tVoxel = timeIt([&]() {
+        for(int y = 1; y <= CaveField::TOP; y++) {
+            sink += perlinNoise3D(glm::vec3(3 / 32.f, y / 16.f, 5 / 32.f));
+        }
+    }) / CaveField::TOP;
+    std::vector<float> height(16 * 16), moisture(16 * 16);
+    double tColumns = timeIt([&]() {
+        batchColumnNoiseGrid(glm::ivec2(0, 4096), 16, 16, height.data(), moisture.data());
+    });
+
+    std::cout << "caves (" << CaveField::POINTS_XZ * CaveField::POINTS_XZ * CaveField::POINTS_Y
+              << " lattice points per chunk, sum " << sink << ")\n"
+              << "  lattice " << tLattice * 1e3 << " ms/chunk, lattice + upsampling "
+              << tTotal * 1e3 << " ms/chunk\n"
+              << "  perlinNoise3D per voxel would take " << tVoxel * voxels * 1e3 << " ms/chunk ("
+              << tVoxel * voxels / tTotal << "x slower)\n"
+              << "  " << 100.0 * caveVoxels / (double(voxels) * chunks) << "% of voxels are cave, "
+              << "carving costs " << tTotal / tColumns << "x a chunk's column noise\n";
+}
+
+// GenerateChunkAt as it was before Chunk had column spans: one
+// setBlockAt per voxel and a getBlockAt before placing water.
+// Kept here so chunkgen can measure the difference.
+static void generateChunkPerVoxel(Chunk &chunk, glm::ivec2 chunkPos, const ZoneMap &zoneMap) {
+    glm::ivec2 zoneOffset = chunkPos - zoneMap.zonePos();
+    for(int x = 0; x < 16; ++x) {
+        for(int z = 0; z < 16; ++z) {
+            float H = zoneMap.heightAt(zoneOffset.x + x, zoneOffset.y + z);
+            BiomeType biome = zoneMap.biomeAt(zoneOffset.x + x, zoneOffset.y + z);
+            BlockType layer = biome == Grass ? DIRT : biome == Desert ? SAND : STONE;
+            for(int i = 0; i < H; i++) {
+                chunk.setBlockAt(x, i, z, (i <= 128 && i > 0) ? STONE : layer);
+            }
+            BlockType topBlock = biome == Grass ? GRASS : biome == Desert ? SAND
+                               : (biome == Snowland || H > 200) ? SNOW : STONE;
+            chunk.setBlockAt(x, H, z, topBlock);
+            for(int i = static_cast<int>(H) + 1; i < Chunk::WATER_LEVEL; i++) {
+                if(chunk.getBlockAt(x, i, z) == EMPTY) {
+                    chunk.setBlockAt(x, i, z, WATER);
+                }
+            }
+        }
+    }
+    chunk.carveCaves(chunkPos, zoneMap);
+}
+
+// Chunks/sec of Chunk::GenerateChunkAt over four zones whose
+// ZoneMaps are computed up front, against the per-voxel fill
+static void benchChunkGen() {
+    const std::vector<glm::ivec2> zonePositions = {{0, 0}, {-64, 128}, {4096, -4096}, {-100032, 64}};
+    std::vector<uPtr<ZoneMap>> zones;
+    std::vector<uPtr<Chunk>> chunks, reference;
+    std::vector<glm::ivec2> chunkPositions;
+    std::vector<const ZoneMap*> chunkZones;
+    for(const glm::ivec2 &zonePos : zonePositions) {
+        zones.push_back(mkU<ZoneMap>(zonePos));
+        for(int x = 0; x < 64; x += 16) {
+            for(int z = 0; z < 64; z += 16) {
+                // No OpenGL context is needed as long as we never touch the VBOs
+                chunks.push_back(mkU<Chunk>(nullptr));
+                reference.push_back(mkU<Chunk>(nullptr));
+                chunkPositions.push_back(zonePos + glm::ivec2(x, z));
+                chunkZones.push_back(zones.back().get());
+            }
+        }
+    }
+    const int count = static_cast<int>(chunks.size());
+
+    int mismatches = 0;
+    for(int i = 0; i < count; i++) {
+        chunks[i]->GenerateChunkAt(chunkPositions[i], *chunkZones[i]);
+        generateChunkPerVoxel(*reference[i], chunkPositions[i], *chunkZones[i]);
+        for(int x = 0; x < 16; x++) {
+            for(int y = 0; y < 256; y++) {
+                for(int z = 0; z < 16; z++) {
+                    mismatches += chunks[i]->getBlockAt(x, y, z) != reference[i]->getBlockAt(x, y, z);
+                }
+            }
+        }
+    }
+
+    // caveStats() lets us take the (shared) cave carving time out of the totals
+    auto measure = [&](const std::function<void(int)> &generate, double &fillSeconds) {
+        CaveStats before = caveStats();
+        int calls = 0;
+        double t = timeIt([&]() {
+            for(int i = 0; i < count; i++) {
+                generate(i);
+            }
+            calls++;
+        });
+        CaveStats after = caveStats();
+        double caveSeconds = (after.nanoseconds - before.nanoseconds) * 1e-9 / (calls + 1);
+        fillSeconds = (t - caveSeconds) / count;
+        return t / count;
+    };
+    double spanFill, voxelFill;
+    double spanTotal = measure([&](int i) { chunks[i]->GenerateChunkAt(chunkPositions[i], *chunkZones[i]); }, spanFill);
+    double voxelTotal = measure([&](int i) { generateChunkPerVoxel(*chunks[i], chunkPositions[i], *chunkZones[i]); }, voxelFill);
+
+    std::cout << "chunk generation (" << count << " chunks, ZoneMaps precomputed)\n"
+              << "  per-voxel setBlockAt: " << 1.0 / voxelTotal << " chunks/sec, "
+              << 1.0 / voxelFill << " chunks/sec without caves\n"
+              << "  column spans: " << 1.0 / spanTotal << " chunks/sec, "
+              << 1.0 / spanFill << " chunks/sec without caves ("
+              << voxelFill / spanFill << "x faster fill)\n"
+              << "  blocks differing between the two " << mismatches << "\n";
+}
+
+// Chunks/sec of a square of zones run through the GenerationPipeline on the
+// global thread pool, against running the same stages one after another on
+// this thread. Only the inner Chunks finish, since the outer ring never gets
+// all 8 neighbors, and only those whose 4 edge neighbors finished too are
+// reported. Every reported Chunk must match the serial result, no matter
+// in which order the decorations of neighboring Chunks ran.
+static void benchPipeline() {
+    const int zonesPerSide = 4;
+    std::vector<uPtr<Chunk>> chunks, reference;
+    std::vector<std::vector<Chunk*>> zoneChunks;
+    std::vector<glm::ivec2> zonePositions;
+    for(int zx = 0; zx < zonesPerSide; zx++) {
+        for(int zz = 0; zz < zonesPerSide; zz++) {
+            glm::ivec2 zonePos(zx * 64 + 8192, zz * 64 - 8192);
+            zonePositions.push_back(zonePos);
+            zoneChunks.emplace_back();
+            for(int x = 0; x < 64; x += 16) {
+                for(int z = 0; z < 64; z += 16) {
+                    chunks.push_back(mkU<Chunk>(nullptr));
+                    chunks.back()->m_position = zonePos + glm::ivec2(x, z);
+                    zoneChunks.back().push_back(chunks.back().get());
+                    reference.push_back(mkU<Chunk>(nullptr));
+                    reference.back()->m_position = chunks.back()->m_position;
+                }
+            }
+        }
+    }
+
+    using clock = std::chrono::steady_clock;
+    auto start = clock::now();
+    {
+        std::vector<uPtr<ZoneMap>> zoneMaps;
+        for(const glm::ivec2 &zonePos : zonePositions) {
+            zoneMaps.push_back(mkU<ZoneMap>(zonePos));
+        }
+        // Each zone's 16 Chunks are stored one after another
+        SpilledWrites spilled;
+        for(size_t i = 0; i < reference.size(); i++) {
+            reference[i]->GenerateChunkAt(reference[i]->m_position, *zoneMaps[i / 16]);
+        }
+        for(size_t i = 0; i < reference.size(); i++) {
+            decorateChunk(*reference[i], reference[i]->m_position, *zoneMaps[i / 16], spilled);
+        }
+        for(uPtr<Chunk> &c : reference) {
+            auto it = spilled.find(toKey(c->m_position.x, c->m_position.y));
+            if(it != spilled.end()) {
+                c->applyBlockWrites(it->second);
+            }
+        }
+    }
+    double serial = std::chrono::duration<double>(clock::now() - start).count();
+
+    std::vector<Chunk*> finished;
+    QMutex finishedLock;
+    std::array<StageTiming, GEN_STAGE_COUNT> timings;
+    uint64_t deferredWrites;
+    start = clock::now();
+    {
+        GenerationPipeline pipeline(QThreadPool::globalInstance(), [&](Chunk *c) {
+            finishedLock.lock();
+            finished.push_back(c);
+            finishedLock.unlock();
+        });
+        // Add the zones in reverse so the pipeline sees a different order
+        for(size_t i = zonePositions.size(); i-- > 0;) {
+            pipeline.addZone(zonePositions[i], zoneChunks[i]);
+        }
+        pipeline.waitForIdle();
+        timings = pipeline.stageTimings();
+        deferredWrites = pipeline.deferredWrites();
+    }
+    double pipelined = std::chrono::duration<double>(clock::now() - start).count();
+
+    // As Terrain does it: each zone's Chunks are made by its first task on
+    // a worker, and linked through the directory once they can be meshed
+    ChunkPool pool(nullptr);
+    ChunkDirectory directory;
+    QMutex linkLock;
+    std::set<const Chunk*> linked;
+    start = clock::now();
+    {
+        GenerationPipeline pipeline(QThreadPool::globalInstance(), [&](Chunk *c) {
+            const std::pair<glm::ivec2, Direction> edges[] = {{{16, 0}, XPOS}, {{-16, 0}, XNEG},
+                                                              {{0, 16}, ZPOS}, {{0, -16}, ZNEG}};
+            linkLock.lock();
+            for(auto &edge : edges) {
+                glm::ivec2 pos = c->m_position + edge.first;
+                c->linkNeighbor(directory.find(pos.x, pos.y), edge.second);
+            }
+            linked.insert(c);
+            linkLock.unlock();
+        });
+        for(size_t i = zonePositions.size(); i-- > 0;) {
+            pipeline.addZone(zonePositions[i], [&](glm::ivec2 pos) {
+                Chunk *c = pool.get(pool.acquire());
+                c->m_position = pos;
+                directory.insert(pos.x, pos.y, c);
+                return c;
+            });
+        }
+        pipeline.waitForIdle();
+    }
+    double madeOnWorkers = std::chrono::duration<double>(clock::now() - start).count();
+    int workerMismatches = 0, wrongLinks = 0;
+    for(const uPtr<Chunk> &ref : reference) {
+        Chunk *c = directory.find(ref->m_position.x, ref->m_position.y);
+        // Each Chunk that can be meshed is linked to its 4 neighbors
+        const ChunkSnapshot snapshot = c->snapshot();
+        const glm::ivec2 edges[] = {{16, 0}, {-16, 0}, {0, 16}, {0, -16}};
+        for(int n = 0; n < 4; n++) {
+            const glm::ivec2 pos = c->m_position + edges[n];
+            const Chunk *neighbor = directory.find(pos.x, pos.y);
+            const bool linkable = neighbor != nullptr && (linked.count(c) > 0 || linked.count(neighbor) > 0);
+            wrongLinks += linkable != (snapshot.neighborMasks[n] != nullptr);
+        }
+        if(linked.count(c) == 0) {
+            continue;
+        }
+        for(int x = 0; x < 16; x++) {
+            for(int y = 0; y < 256; y++) {
+                for(int z = 0; z < 16; z++) {
+                    workerMismatches += c->getBlockAt(x, y, z) != ref->getBlockAt(x, y, z);
+                }
+            }
+        }
+    }
+
+    int mismatches = 0;
+    for(Chunk *c : finished) {
+        const Chunk &ref = *reference[std::find_if(chunks.begin(), chunks.end(),
+                                                   [c](const uPtr<Chunk> &p) { return p.get() == c; }) - chunks.begin()];
+        for(int x = 0; x < 16; x++) {
+            for(int y = 0; y < 256; y++) {
+                for(int z = 0; z < 16; z++) {
+                    mismatches += c->getBlockAt(x, y, z) != ref.getBlockAt(x, y, z);
+                }
+            }
+        }
+    }
+
+    std::cout << "generation pipeline (" << chunks.size() << " chunks, "
+              << QThreadPool::globalInstance()->maxThreadCount() << " threads)\n"
+              << "  serial: " << chunks.size() / serial << " chunks/sec\n"
+              << "  pipeline: " << chunks.size() / pipelined << " chunks/sec ("
+              << serial / pipelined << "x), " << finished.size() << " chunks finished\n"
+              << "  blocks queued for neighboring chunks " << deferredWrites
+              << ", blocks differing from the serial result " << mismatches << "\n"
+              << "  chunks made and linked on workers: " << chunks.size() / madeOnWorkers
+              << " chunks/sec, " << linked.size() << " chunks linked, blocks differing from the serial result "
+              << workerMismatches << ", neighbor links wrong " << wrongLinks << "\n";
+    for(int i = 0; i < GEN_STAGE_COUNT; i++) {
+        const StageTiming &t = timings[i];
+        std::cout << "    " << genStageName(static_cast<GenStage>(i)) << ": " << t.tasks << " tasks, "
+                  << (t.tasks ? t.nanoseconds / 1e6 / t.tasks : 0.0) << " ms each\n";
+    }
+}
+
+// One zone of generated terrain whose Chunks are linked to each other,
+// as the mesher sees it
+static std::vector<uPtr<Chunk>> meshingZone() {
+    const glm::ivec2 zonePos(-64, 4096);
+    ZoneMap zoneMap(zonePos);
+    std::vector<uPtr<Chunk>> chunks;
+    for(int x = 0; x < 64; x += 16) {
+        for(int z = 0; z < 64; z += 16) {
+            chunks.push_back(mkU<Chunk>(nullptr));
+            chunks.back()->m_position = zonePos + glm::ivec2(x, z);
+            chunks.back()->GenerateChunkAt(chunks.back()->m_position, zoneMap);
+            // As the pipeline's Light stage does before handing it over
+            chunks.back()->compactBlocks();
+        }
+    }
+    // Chunk (x, z) of the zone is chunks[4 * x + z]
+    for(int x = 0; x < 4; x++) {
+        for(int z = 0; z < 4; z++) {
+            if(x < 3) {
+                chunks[4 * x + z]->linkNeighbor(chunks[4 * (x + 1) + z].get(), XPOS);
+            }
+            if(z < 3) {
+                chunks[4 * x + z]->linkNeighbor(chunks[4 * x + z + 1].get(), ZPOS);
+            }
+        }
+    }
+    return chunks;
+}
+
+// Chunks/sec of createVBOdata over meshingZone(). The checksum covers
+// every vertex, so a change to the mesher can be checked against the
+// previous output. It is of float vertices, whatever the default format.
+static void benchMeshing() {
+    std::vector<uPtr<Chunk>> chunks = meshingZone();
+    const VertexFormat format = Chunk::vertexFormat();
+    Chunk::setVertexFormat(VertexFormat::Float);
+
+    double t = timeIt([&]() {
+        for(uPtr<Chunk> &c : chunks) {
+            c->createVBOdata();
+        }
+    });
+
+    size_t opaqueFloats = 0, transparentFloats = 0, indices = 0;
+    double checksum = 0.0;
+    for(uPtr<Chunk> &c : chunks) {
+        const ChunkVBOData &data = c->m_chunkVBOData;
+        opaqueFloats += 4 * data.m_op.size();
+        transparentFloats += 4 * data.m_trans.size();
+        indices += data.m_opIdx.size() + data.m_transIdx.size();
+        for(const std::vector<glm::vec4> *buffer : {&data.m_op, &data.m_trans}) {
+            for(size_t i = 0; i < buffer->size(); i++) {
+                const glm::vec4 &v = (*buffer)[i];
+                checksum += (i % 7 + 1) * (v.x + 3.0 * v.y + 5.0 * v.z + 7.0 * v.w);
+            }
+        }
+    }
+    std::cout << "meshing (" << chunks.size() << " chunks)\n"
+              << "  " << chunks.size() / t << " chunks/sec\n"
+              << "  " << (opaqueFloats + transparentFloats) * sizeof(float) / chunks.size()
+              << " vertex bytes and " << indices / chunks.size() << " indices per chunk, checksum "
+              << std::fixed << checksum << std::defaultfloat << "\n";
+    Chunk::setVertexFormat(format);
+}
+
+// Finding the visible faces of meshingZone(), without building vertices:
+// testing each block against each of its 6 neighbors in a PaddedBlockView
+// as createVBOdata used to, against ANDing whole columns of OccupancyMasks.
+static void benchFaceMasks() {
+    std::vector<uPtr<Chunk>> chunks = meshingZone();
+    std::vector<ChunkSnapshot> snapshots;
+    std::vector<PaddedBlockView> views(chunks.size());
+    // The sections createVBOdata used to skip
+    std::vector<std::array<bool, Chunk::SECTION_COUNT>> skips(chunks.size());
+    for(size_t i = 0; i < chunks.size(); i++) {
+        snapshots.push_back(chunks[i]->snapshot());
+        snapshots[i].fillPaddedView(views[i]);
+        for(int s = 0; s < Chunk::SECTION_COUNT; s++) {
+            skips[i][s] = !snapshots[i].sectionHasFaces(s);
+        }
+    }
+    const int offsets[6] = {PaddedBlockView::STRIDE_X, -PaddedBlockView::STRIDE_X,
+                            PaddedBlockView::STRIDE_Y, -PaddedBlockView::STRIDE_Y,
+                            PaddedBlockView::STRIDE_Z, -PaddedBlockView::STRIDE_Z};
+
+    // Hidden by an opaque neighbor, or between two see-through blocks
+    size_t perBlockFaces = 0;
+    const double perBlock = timeIt([&]() {
+        perBlockFaces = 0;
+        for(size_t c = 0; c < views.size(); c++) {
+            const BlockType *blocks = views[c].blocks.data();
+            for(int x = 0; x < 16; x++) {
+                for(int z = 0; z < 16; z++) {
+                    for(int y = 0; y < 256; y++) {
+                        if(skips[c][y >> 4]) {
+                            y += 15;
+                            continue;
+                        }
+                        const int i = PaddedBlockView::index(x, y, z);
+                        if(blocks[i] != EMPTY) {
+                            const bool opaque = blockInfo(blocks[i]).opaque;
+                            for(int offset : offsets) {
+                                const BlockType n = blocks[i + offset];
+                                perBlockFaces += !blockInfo(n).opaque && (opaque || n == EMPTY);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    });
+
+    size_t maskFaces = 0;
+    OccupancyMasks masks;
+    std::array<OccupancyMasks::Column, 6> faces;
+    auto countFaces = [&]() {
+        for(int x = 0; x < 16; x++) {
+            for(int z = 0; z < 16; z++) {
+                masks.faces(x, z, faces);
+                for(const OccupancyMasks::Column &column : faces) {
+                    for(uint64_t word : column) {
+                        maskFaces += std::bitset<64>(word).count();
+                    }
+                }
+            }
+        }
+    };
+    const double masked = timeIt([&]() {
+        maskFaces = 0;
+        for(const ChunkSnapshot &snapshot : snapshots) {
+            masks.build(snapshot);
+            countFaces();
+        }
+    });
+    const double building = timeIt([&]() {
+        for(const ChunkSnapshot &snapshot : snapshots) {
+            masks.build(snapshot);
+        }
+    });
+
+    std::cout << "face masks (" << chunks.size() << " chunks, " << perBlockFaces / chunks.size() << " faces each)\n"
+              << "  block by block: " << chunks.size() / perBlock << " chunks/sec\n"
+              << "  occupancy masks: " << chunks.size() / masked << " chunks/sec (" << perBlock / masked
+              << "x), of which building the masks takes " << 100.0 * building / masked << "%\n"
+              << "  faces found " << (maskFaces == perBlockFaces ? "match" : "DIFFER") << "\n";
+}
+
+// Naive against greedy meshing of meshingZone(): vertices, the bytes
+// createVBO would upload, and meshing time. Frame time needs a GPU, so
+// it is shown in-game instead, next to the same counts (G toggles).
+// Every naive face must be covered by exactly one greedy quad of the same
+// direction and tile, so their areas are compared as well.
+static void benchGreedy() {
+    std::vector<uPtr<Chunk>> chunks = meshingZone();
+    std::vector<ChunkSnapshot> snapshots;
+    for(uPtr<Chunk> &c : chunks) {
+        snapshots.push_back(c->snapshot());
+    }
+
+    // Face area by (direction, tile). Each quad is 4 vertices of 3 vec4s:
+    // position, normal and UV.
+    typedef std::map<std::pair<int, int>, size_t> Areas;
+    auto addAreas = [](const std::vector<glm::vec4> &buffer, MeshingMode mode, Areas &areas) {
+        for(size_t q = 0; q + 12 <= buffer.size(); q += 12) {
+            const glm::vec4 &normal = buffer[q + 1];
+            const int direction = int(normal.x + 1) + 3 * int(normal.y + 1) + 9 * int(normal.z + 1);
+            if(mode == MeshingMode::Greedy) {
+                // Corner 2's UV is the quad's size in blocks
+                const glm::vec4 &size = buffer[q + 8];
+                areas[{direction, int(normal.w) - 2}] += size_t(size.x) * size_t(size.y);
+            } else {
+                const glm::vec4 &uv = buffer[q + 2];
+                areas[{direction, int(std::lround(16 * uv.x)) + 16 * int(std::lround(16 * uv.y))}]++;
+            }
+        }
+    };
+
+    std::cout << "greedy meshing (" << chunks.size() << " chunks)\n";
+    Areas areas[2];
+    double times[2];
+    size_t vertices[2];
+    const MeshingMode modes[2] = {MeshingMode::Naive, MeshingMode::Greedy};
+    for(int m = 0; m < 2; m++) {
+        for(ChunkSnapshot &snapshot : snapshots) {
+            snapshot.meshing = modes[m];
+            snapshot.format = VertexFormat::Float;
+        }
+        std::vector<ChunkVBOData> out(chunks.size(), ChunkVBOData(nullptr));
+        times[m] = timeIt([&]() {
+            for(size_t i = 0; i < snapshots.size(); i++) {
+                Chunk::createVBOdata(snapshots[i], out[i]);
+            }
+        });
+        size_t floats = 0, indices = 0;
+        for(const ChunkVBOData &data : out) {
+            floats += 4 * (data.m_op.size() + data.m_trans.size());
+            indices += data.m_opIdx.size() + data.m_transIdx.size();
+            addAreas(data.m_op, modes[m], areas[m]);
+            addAreas(data.m_trans, modes[m], areas[m]);
+        }
+        vertices[m] = floats / 12;
+        std::cout << "  " << (m == 0 ? "naive: " : "greedy: ") << vertices[m] / chunks.size()
+                  << " vertices and " << (floats * sizeof(float) + indices * sizeof(GLuint)) / 1024 / chunks.size()
+                  << " KiB per chunk, " << chunks.size() / times[m] << " chunks/sec\n";
+    }
+    std::cout << "  greedy has " << 100.0 * vertices[1] / vertices[0] << "% of the vertices, meshes "
+              << times[0] / times[1] << "x as fast\n"
+              << "  faces covered " << (areas[0] == areas[1] ? "match" : "DIFFER") << "\n";
+}
+
+// Float against packed vertices over meshingZone(), meshed both ways:
+// bytes uploaded and meshing time. Every packed vertex is decoded as
+// lambert.vert.glsl does and must give back the float vertex exactly.
+static void benchPackedVertices() {
+    std::vector<uPtr<Chunk>> chunks = meshingZone();
+    std::vector<ChunkSnapshot> snapshots;
+    for(uPtr<Chunk> &c : chunks) {
+        snapshots.push_back(c->snapshot());
+    }
+    const glm::vec3 directions[6] = {glm::vec3(1, 0, 0), glm::vec3(-1, 0, 0), glm::vec3(0, 1, 0),
+                                     glm::vec3(0, -1, 0), glm::vec3(0, 0, 1), glm::vec3(0, 0, -1)};
+    // The position, normal and UV the shader rebuilds from v
+    auto decode = [&](glm::uvec2 v, glm::vec4 out[3]) {
+        const uint32_t geometry = v.x, material = v.y;
+        const float tile = float(material & 255u);
+        const glm::vec2 corner(material >> 8 & 31u, material >> 13 & 511u);
+        const bool tiled = (material & (1u << 23)) != 0;
+        out[0] = glm::vec4(geometry & 31u, geometry >> 5 & 511u, geometry >> 14 & 31u, 1);
+        out[1] = glm::vec4(directions[geometry >> 19 & 7u], tiled ? 2.f + tile : 1.f);
+        const glm::vec2 uv = tiled ? corner : (glm::vec2(std::fmod(tile, 16.f), std::floor(tile / 16)) + corner) / 16.f;
+        out[2] = glm::vec4(uv, (material & (1u << 22)) != 0 ? 0.f : 1.f, float(material >> 24) / 255);
+    };
+
+    std::cout << "packed vertices (" << chunks.size() << " chunks)\n";
+    const std::pair<MeshingMode, const char*> modes[2] = {{MeshingMode::Naive, "naive"}, {MeshingMode::Greedy, "greedy"}};
+    for(const std::pair<MeshingMode, const char*> &mode : modes) {
+        std::vector<ChunkVBOData> out[2];
+        double times[2];
+        size_t vertexBytes[2] = {0, 0}, indexBytes = 0;
+        const VertexFormat formats[2] = {VertexFormat::Float, VertexFormat::Packed};
+        for(int f = 0; f < 2; f++) {
+            for(ChunkSnapshot &snapshot : snapshots) {
+                snapshot.meshing = mode.first;
+                snapshot.format = formats[f];
+            }
+            out[f].assign(chunks.size(), ChunkVBOData(nullptr));
+            times[f] = timeIt([&]() {
+                for(size_t i = 0; i < snapshots.size(); i++) {
+                    Chunk::createVBOdata(snapshots[i], out[f][i]);
+                }
+            });
+            for(const ChunkVBOData &data : out[f]) {
+                vertexBytes[f] += (data.m_op.size() + data.m_trans.size()) * sizeof(glm::vec4)
+                    + (data.m_opPacked.size() + data.m_transPacked.size()) * sizeof(glm::uvec2);
+                indexBytes += f == 0 ? (data.m_opIdx.size() + data.m_transIdx.size()) * sizeof(GLuint) : 0;
+            }
+        }
+
+        size_t vertices = 0, differing = 0;
+        float maxAlphaError = 0.f;
+        for(size_t i = 0; i < chunks.size(); i++) {
+            const std::pair<const std::vector<glm::vec4>*, const std::vector<glm::uvec2>*> buffers[2] =
+                {{&out[0][i].m_op, &out[1][i].m_opPacked}, {&out[0][i].m_trans, &out[1][i].m_transPacked}};
+            for(const auto &buffer : buffers) {
+                const std::vector<glm::vec4> &floats = *buffer.first;
+                const std::vector<glm::uvec2> &packed = *buffer.second;
+                differing += packed.size() * 3 != floats.size();
+                for(size_t v = 0; v < packed.size() && 3 * v + 2 < floats.size(); v++) {
+                    glm::vec4 decoded[3];
+                    decode(packed[v], decoded);
+                    // Alpha is kept to 8 bits
+                    maxAlphaError = std::max(maxAlphaError, std::abs(decoded[2].w - floats[3 * v + 2].w));
+                    decoded[2].w = floats[3 * v + 2].w;
+                    differing += decoded[0] != floats[3 * v] || decoded[1] != floats[3 * v + 1]
+                        || decoded[2] != floats[3 * v + 2];
+                    vertices++;
+                }
+            }
+        }
+        std::cout << "  " << mode.second << ": " << vertexBytes[0] / 1024 / chunks.size() << " KiB of float and "
+                  << vertexBytes[1] / 1024 / chunks.size() << " KiB of packed vertices per chunk ("
+                  << double(vertexBytes[0]) / vertexBytes[1] << "x), plus " << indexBytes / 1024 / chunks.size()
+                  << " KiB of indices\n"
+                  << "    meshing " << chunks.size() / times[0] << " float, " << chunks.size() / times[1]
+                  << " packed chunks/sec\n"
+                  << "    " << differing << " of " << vertices << " vertices decode differently, alpha within "
+                  << maxAlphaError << "\n";
+    }
+}
+
+// The highest block of column (x, z) of chunk that passes counts,
+// found by testing every block from the top down
+static int scanHeight(const Chunk &chunk, int x, int z, bool (*counts)(BlockType)) {
+    for(int y = 255; y >= 0; y--) {
+        if(counts(chunk.getBlockAt(x, y, z))) {
+            return y;
+        }
+    }
+    return -1;
+}
+
+// Chunk::topNonAir and topSolid over meshingZone(), checked against
+// scanning every column after generation and after random edits, and
+// timed against that scan, with every column known and with every
+// column left unknown by removing its highest block.
+static void benchHeights() {
+    std::vector<uPtr<Chunk>> chunks = meshingZone();
+    auto nonAir = [](BlockType t) { return t != EMPTY; };
+    auto solid = [](BlockType t) { return blockInfo(t).collides; };
+    size_t mismatches = 0;
+    auto check = [&]() {
+        for(const uPtr<Chunk> &c : chunks) {
+            for(int x = 0; x < 16; x++) {
+                for(int z = 0; z < 16; z++) {
+                    mismatches += c->topNonAir(x, z) != scanHeight(*c, x, z, nonAir);
+                    mismatches += c->topSolid(x, z) != scanHeight(*c, x, z, solid);
+                    for(int y = 0; y < 256; y++) {
+                        mismatches += c->hasBlockAt(x, y, z) != (c->getBlockAt(x, y, z) != EMPTY);
+                    }
+                }
+            }
+        }
+    };
+    // The edits keep the block masks up to date as well
+    for(const uPtr<Chunk> &c : chunks) {
+        c->updateMasks();
+    }
+    check();
+
+    // Edits clustered around the surface, where they can move the heights
+    std::mt19937 rng(20);
+    const BlockType types[] = {EMPTY, EMPTY, STONE, WATER, GRASS};
+    for(int round = 0; round < 16; round++) {
+        for(int i = 0; i < 2000; i++) {
+            Chunk &c = *chunks[rng() % chunks.size()];
+            const int x = rng() % 16, z = rng() % 16;
+            const int top = std::max(c.topNonAir(x, z), 12);
+            const int y = std::min(255, top - 8 + int(rng() % 12));
+            const BlockType t = types[rng() % 5];
+            switch(rng() % 5) {
+            case 0:
+                c.fillColumn(x, z, y - 4, y + 1, t);
+                break;
+            case 1:
+                c.fillColumnIfEmpty(x, z, y - 4, y + 1, t);
+                break;
+            case 2:
+                // Empty and inverted spans, which write nothing
+                c.fillColumn(x, z, y, y - int(rng() % 4), t);
+                break;
+            default:
+                c.setBlockAt(x, y, z, t);
+                break;
+            }
+        }
+        check();
+    }
+
+    size_t sink = 0;
+    const double scanning = timeIt([&]() {
+        for(const uPtr<Chunk> &c : chunks) {
+            for(int x = 0; x < 16; x++) {
+                for(int z = 0; z < 16; z++) {
+                    sink += scanHeight(*c, x, z, solid);
+                }
+            }
+        }
+    });
+    const double known = timeIt([&]() {
+        for(const uPtr<Chunk> &c : chunks) {
+            for(int x = 0; x < 16; x++) {
+                for(int z = 0; z < 16; z++) {
+                    sink += c->topSolid(x, z);
+                }
+            }
+        }
+    });
+    // Removing and restoring each highest block,
+    // so every lookup has to scan its column again
+    const double unknown = timeIt([&]() {
+        for(const uPtr<Chunk> &c : chunks) {
+            for(int x = 0; x < 16; x++) {
+                for(int z = 0; z < 16; z++) {
+                    const int top = c->topNonAir(x, z);
+                    if(top < 0) {
+                        continue;
+                    }
+                    const BlockType t = c->getBlockAt(x, top, z);
+                    c->setBlockAt(x, top, z, EMPTY);
+                    c->setBlockAt(x, top, z, t);
+                    sink += c->topSolid(x, z);
+                }
+            }
+        }
+    });
+    const double columns = 256.0 * chunks.size();
+
+    std::cout << "column heights (" << chunks.size() << " chunks, sum " << sink << ")\n"
+              << "  scanning each column: " << columns / scanning / 1e6 << " M columns/sec\n"
+              << "  heightmap: " << columns / known / 1e6 << " M columns/sec ("
+              << scanning / known << "x)\n"
+              << "  heightmap after removing the top block: " << columns / unknown / 1e6
+              << " M columns/sec (" << scanning / unknown << "x)\n"
+              << "  heights and masks after 32000 edits " << (mismatches == 0 ? "match" : "DIFFER") << "\n";
+}
+
+// Memory taken by one Chunk: the object itself and whatever
+// it allocates on the heap when it is constructed
+static void benchChunkMemory() {
+    const int count = 256;
+    std::vector<uPtr<Chunk>> chunks;
+    chunks.reserve(count);
+    size_t before = g_heapBytes;
+    for(int i = 0; i < count; i++) {
+        chunks.push_back(mkU<Chunk>(nullptr));
+    }
+    size_t perChunk = (g_heapBytes - before) / count;
+    std::cout << "chunk memory\n"
+              << "  " << perChunk << " bytes per chunk: sizeof(Chunk) " << sizeof(Chunk)
+              << ", heap " << perChunk - sizeof(Chunk) << "\n"
+              << "  " << perChunk * 1000 / (1024.0 * 1024.0) << " MiB per 1000 chunks\n";
+}
+
+// Block storage of every Chunk of a large explored area, against the 64 KiB
+// each took at one byte per block, how many of their 16^3 sections are
+// uniform and store no blocks at all, and how fast the mesher's bulk decode
+// unpacks a Chunk compared to reading it one getBlockAt at a time
+static void benchBlockMemory() {
+    const int zonesPerSide = 8;
+    std::vector<uPtr<Chunk>> chunks;
+    {
+        GenerationPipeline pipeline(QThreadPool::globalInstance(), [](Chunk*) {});
+        for(int zx = 0; zx < zonesPerSide; zx++) {
+            for(int zz = 0; zz < zonesPerSide; zz++) {
+                glm::ivec2 zonePos(zx * 64 - 2048, zz * 64 + 2048);
+                std::vector<Chunk*> zone;
+                for(int x = 0; x < 64; x += 16) {
+                    for(int z = 0; z < 64; z += 16) {
+                        chunks.push_back(mkU<Chunk>(nullptr));
+                        chunks.back()->m_position = zonePos + glm::ivec2(x, z);
+                        zone.push_back(chunks.back().get());
+                    }
+                }
+                pipeline.addZone(zonePos, zone);
+            }
+        }
+        pipeline.waitForIdle();
+    }
+
+    // Only the inner Chunks made it through the Light stage and were compacted
+    const int inner = zonesPerSide * 4 - 2;
+    size_t packed = 0;
+    int bitsHistogram[9] = {};
+    int emptySections = 0, uniformSections = 0, meshedSections = 0;
+    std::vector<Chunk*> finished;
+    for(const uPtr<Chunk> &c : chunks) {
+        glm::ivec2 local = (c->m_position - glm::ivec2(-2048, 2048)) / 16;
+        if(local.x > 0 && local.y > 0 && local.x <= inner && local.y <= inner) {
+            finished.push_back(c.get());
+            packed += c->blockBytes();
+            for(int s = 0; s < Chunk::SECTION_COUNT; s++) {
+                const PalettedBlocks &section = c->section(s);
+                bitsHistogram[section.bitsPerBlock()]++;
+                if(section.isUniform()) {
+                    (section.uniformType() == EMPTY ? emptySections : uniformSections)++;
+                }
+            }
+        }
+    }
+    // Sections the mesher skips, once each Chunk knows its neighbors
+    std::unordered_map<int64_t, uPtr<Chunk>*> byPos;
+    for(uPtr<Chunk> &c : chunks) {
+        byPos[toKey(c->m_position.x, c->m_position.y)] = &c;
+    }
+    for(uPtr<Chunk> &c : chunks) {
+        auto xpos = byPos.find(toKey(c->m_position.x + 16, c->m_position.y));
+        auto zpos = byPos.find(toKey(c->m_position.x, c->m_position.y + 16));
+        if(xpos != byPos.end()) {
+            c->linkNeighbor(xpos->second->get(), XPOS);
+        }
+        if(zpos != byPos.end()) {
+            c->linkNeighbor(zpos->second->get(), ZPOS);
+        }
+    }
+    for(Chunk *c : finished) {
+        const ChunkSnapshot snapshot = c->snapshot();
+        for(int s = 0; s < Chunk::SECTION_COUNT; s++) {
+            meshedSections += snapshot.sectionHasFaces(s);
+        }
+    }
+    const double flat = finished.size() * 65536.0;
+    const double sections = finished.size() * Chunk::SECTION_COUNT;
+
+    using clock = std::chrono::steady_clock;
+    std::vector<BlockType> decoded(65536);
+    double checksum = 0;
+    auto start = clock::now();
+    for(const Chunk *c : finished) {
+        for(int x = 0; x < 16; x++) {
+            for(int z = 0; z < 16; z++) {
+                for(int y = 0; y < 256; y++) {
+                    decoded[Chunk::decodedIndex(x, y, z)] = c->getBlockAt(x, y, z);
+                }
+            }
+        }
+        checksum += decoded[Chunk::decodedIndex(8, 100, 8)];
+    }
+    const double perBlock = std::chrono::duration<double>(clock::now() - start).count();
+    start = clock::now();
+    for(const Chunk *c : finished) {
+        c->decodeBlocks(decoded.data());
+        checksum += decoded[Chunk::decodedIndex(8, 100, 8)];
+    }
+    const double bulk = std::chrono::duration<double>(clock::now() - start).count();
+
+    std::cout << "block memory (" << finished.size() << " generated chunks)\n"
+              << "  " << packed / (1024.0 * 1024.0) << " MiB palette-packed against "
+              << flat / (1024.0 * 1024.0) << " MiB at a byte per block ("
+              << flat / packed << "x smaller), " << packed / finished.size() << " bytes per chunk\n"
+              << "  sections at 0/1/2/4/8 bits per block: " << bitsHistogram[0] << " / " << bitsHistogram[1]
+              << " / " << bitsHistogram[2] << " / " << bitsHistogram[4] << " / " << bitsHistogram[8] << "\n"
+              << "  uniform sections storing no blocks: " << 100.0 * emptySections / sections << "% empty, "
+              << 100.0 * uniformSections / sections << "% of another type\n"
+              << "  sections skipped by the mesher: " << 100.0 * (sections - meshedSections) / sections << "%\n"
+              << "  decoding: " << finished.size() / perBlock << " chunks/sec with getBlockAt, "
+              << finished.size() / bulk << " chunks/sec in bulk (" << perBlock / bulk << "x, checksum "
+              << checksum << ")\n";
+}
+
+// Chunk storage while walking 64 zones in a straight line and keeping the
+// 5 x 5 zones around the walker resident, as Terrain will once it unloads
+// zones: each step creates 5 zones' worth of Chunks and destroys another
+// 5. One Chunk per allocation against a ChunkPool that recycles the slots
+// of destroyed Chunks.
+static void benchChunkPool() {
+    const int steps = 64;
+    // The zone with index i holds Chunks 16 * i to 16 * i + 15
+    auto zonesAt = [](int step) {
+        std::vector<int> zones;
+        for(int x = step - 2; x <= step + 2; x++) {
+            for(int z = 0; z < 5; z++) {
+                zones.push_back(x * 5 + z);
+            }
+        }
+        return zones;
+    };
+
+    auto perChunk = [&]() {
+        std::unordered_map<int, std::vector<uPtr<Chunk>>> resident;
+        for(int step = 0; step < steps; step++) {
+            std::vector<int> zones = zonesAt(step);
+            for(auto it = resident.begin(); it != resident.end();) {
+                it = std::find(zones.begin(), zones.end(), it->first) == zones.end() ? resident.erase(it) : ++it;
+            }
+            for(int zone : zones) {
+                std::vector<uPtr<Chunk>> &chunks = resident[zone];
+                for(int i = static_cast<int>(chunks.size()); i < 16; i++) {
+                    chunks.push_back(mkU<Chunk>(nullptr));
+                }
+            }
+        }
+    };
+    ChunkPoolCounters counters;
+    auto pooled = [&]() {
+        ChunkPool pool(nullptr);
+        std::unordered_map<int, std::vector<ChunkHandle>> resident;
+        for(int step = 0; step < steps; step++) {
+            std::vector<int> zones = zonesAt(step);
+            for(auto it = resident.begin(); it != resident.end();) {
+                if(std::find(zones.begin(), zones.end(), it->first) == zones.end()) {
+                    for(ChunkHandle h : it->second) {
+                        pool.release(h);
+                    }
+                    it = resident.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+            for(int zone : zones) {
+                std::vector<ChunkHandle> &chunks = resident[zone];
+                for(int i = static_cast<int>(chunks.size()); i < 16; i++) {
+                    chunks.push_back(pool.acquire());
+                }
+            }
+        }
+        counters = pool.counters();
+    };
+
+    size_t before = g_heapAllocs;
+    perChunk();
+    const size_t perChunkAllocs = g_heapAllocs - before;
+    before = g_heapAllocs;
+    pooled();
+    const size_t pooledAllocs = g_heapAllocs - before;
+    const double perChunkTime = timeIt(perChunk, 0.25);
+    const double pooledTime = timeIt(pooled, 0.25);
+    const uint64_t chunksPerRun = counters.acquired;
+
+    // What Terrain::instantiateChunkAt does on a worker for a zone's 16
+    // Chunks: acquiring them and adding them to the directory
+    const int zonesPerSide = 20;
+    const double instantiating = timeIt([&]() {
+        ChunkPool pool(nullptr);
+        ChunkDirectory directory;
+        for(int zx = 0; zx < zonesPerSide; zx++) {
+            for(int zz = 0; zz < zonesPerSide; zz++) {
+                for(int i = 0; i < 16; i++) {
+                    const int x = 64 * zx + 16 * (i / 4), z = 64 * zz + 16 * (i % 4);
+                    directory.insert(x, z, pool.get(pool.acquire()));
+                }
+            }
+        }
+    }, 0.25);
+
+    std::cout << "chunk pool (" << chunksPerRun << " chunks created while walking " << steps << " zones)\n"
+              << "  one allocation per chunk: " << chunksPerRun / perChunkTime << " chunks/sec, "
+              << perChunkAllocs << " heap allocations\n"
+              << "  pool: " << chunksPerRun / pooledTime << " chunks/sec, " << pooledAllocs << " heap allocations, " << counters.arenas << " arenas of "
+              << ChunkPool::ARENA_CHUNKS << " chunks, " << counters.recycled << " slots recycled, "
+              << counters.live << " live at the end\n"
+              << "  (both include the bookkeeping of the walk itself)\n"
+              << "  instantiating a zone's chunks on a worker: "
+              << instantiating / (zonesPerSide * zonesPerSide) * 1e6 << " us\n";
+}
+
+// toKey as it used to be, before it was inlined
+static int64_t maskedKey(int x, int z) {
+    int64_t xz = 0xffffffffffffffff;
+    int64_t x64 = x;
+    int64_t z64 = z;
+    xz = (xz & (x64 << 32)) | 0x00000000ffffffff;
+    z64 = z64 | 0xffffffff00000000;
+    return xz & z64;
+}
+
+// Block queries by world coordinates over 32 x 32 Chunks around the
+// origin, as Terrain::getBlockAt used to answer them (flooring floats,
+// then hasChunkAt and getChunkAt hashing the key twice) against a
+// ChunkMap. Random queries anywhere, and coherent ones stepping along
+// rays one block at a time as gridMarch and the player's collision do.
+static void benchChunkLookup() {
+    ChunkPool pool(nullptr);
+    ChunkMap map(pool);
+    std::unordered_map<int64_t, ChunkHandle> handles;
+    std::mt19937 rng(21);
+    for(int x = -256; x < 256; x += 16) {
+        for(int z = -256; z < 256; z += 16) {
+            ChunkHandle handle = pool.acquire();
+            Chunk *c = pool.get(handle);
+            c->m_position = glm::ivec2(x, z);
+            for(int i = 0; i < 256; i++) {
+                c->fillColumn(i % 16, i / 16, 0, 60 + rng() % 8, i % 3 ? STONE : DIRT);
+            }
+            map.insert(x, z, handle);
+            handles[toKey(x, z)] = handle;
+        }
+    }
+
+    const int count = 1 << 20;
+    std::vector<glm::ivec3> random(count), coherent;
+    for(glm::ivec3 &p : random) {
+        p = glm::ivec3(int(rng() % 512) - 256, rng() % 256, int(rng() % 512) - 256);
+    }
+    std::uniform_real_distribution<float> unit(-1.f, 1.f);
+    while(coherent.size() < size_t(count)) {
+        glm::vec3 p(unit(rng) * 200.f, 40.f + 40.f * unit(rng), unit(rng) * 200.f);
+        const glm::vec3 step = glm::normalize(glm::vec3(unit(rng), 0.3f * unit(rng), unit(rng)));
+        for(int i = 0; i < 64 && p.y >= 0.f; i++, p += step) {
+            coherent.push_back(glm::ivec3(glm::floor(p)));
+        }
+    }
+
+    auto floating = [&](const std::vector<glm::ivec3> &queries) {
+        auto find = [&](int x, int z) {
+            int xFloor = static_cast<int>(glm::floor(x / 16.f));
+            int zFloor = static_cast<int>(glm::floor(z / 16.f));
+            return handles.find(maskedKey(16 * xFloor, 16 * zFloor));
+        };
+        uint64_t sum = 0;
+        for(const glm::ivec3 &p : queries) {
+            if(find(p.x, p.z) != handles.end()) {
+                const Chunk *c = pool.get(find(p.x, p.z)->second);
+                glm::vec2 chunkOrigin = glm::vec2(floor(p.x / 16.f) * 16, floor(p.z / 16.f) * 16);
+                sum += static_cast<uint64_t>(c->getBlockAt(p.x - chunkOrigin.x, p.y, p.z - chunkOrigin.y));
+            }
+        }
+        return sum;
+    };
+    auto integer = [&](const std::vector<glm::ivec3> &queries) {
+        uint64_t sum = 0;
+        for(const glm::ivec3 &p : queries) {
+            const Chunk *c = map.find(p.x, p.z);
+            if(c != nullptr) {
+                sum += static_cast<uint64_t>(c->getBlockAt(p.x & 15, p.y, p.z & 15));
+            }
+        }
+        return sum;
+    };
+
+    std::cout << "chunk lookup (" << map.size() << " chunks, " << count << " queries per run)\n";
+    const std::pair<const char*, const std::vector<glm::ivec3>*> runs[] = {{"random", &random},
+                                                                          {"coherent", &coherent}};
+    for(auto &run : runs) {
+        uint64_t floatSum = 0, intSum = 0;
+        const double tFloat = timeIt([&]() { floatSum = floating(*run.second); });
+        const double tInt = timeIt([&]() { intSum = integer(*run.second); });
+        std::cout << "  " << run.first << ": floor and two lookups " << count / tFloat / 1e6
+                  << " M queries/sec, ChunkMap " << count / tInt / 1e6 << " M queries/sec ("
+                  << tFloat / tInt << "x), blocks " << (floatSum == intSum ? "match" : "DIFFER") << "\n";
+    }
+}
+
+// A walk 48 zones east with the 5 x 5 zones around the walker resident
+// and none ever evicted, as with a large memory budget. At the end, the
+// Chunks near the walker are visited by iterating every Chunk in the
+// hash map, as Terrain::draw used to, against iterating ChunkMap's
+// resident grid, and their 4 neighbors are looked up by hash against
+// through the grid. Every step checks that recentering the grid kept
+// each of its slots pointing at the Chunk there.
+static void benchResidentGrid() {
+    ChunkPool pool(nullptr);
+    ChunkMap map(pool);
+    std::unordered_map<int64_t, ChunkHandle> handles;
+    const int steps = 48;
+    size_t mismatches = 0;
+    glm::ivec2 walker(-64, 32);
+    for(int step = 0; step < steps; step++) {
+        for(int zx = -2; zx <= 2; zx++) {
+            for(int zz = -2; zz <= 2; zz++) {
+                const glm::ivec2 zone = 64 * (glm::ivec2(step, 0) + glm::ivec2(zx, zz));
+                for(int x = zone.x; x < zone.x + 64; x += 16) {
+                    for(int z = zone.y; z < zone.y + 64; z += 16) {
+                        if(handles.count(toKey(x, z)) == 0) {
+                            ChunkHandle handle = pool.acquire();
+                            pool.get(handle)->m_position = glm::ivec2(x, z);
+                            handles[toKey(x, z)] = handle;
+                            map.insert(x, z, handle);
+                        }
+                    }
+                }
+            }
+        }
+        // In 4 moves, so the grid scrolls a Chunk at a time
+        for(int i = 0; i < 4; i++) {
+            walker.x += 16;
+            map.recenter(walker.x, walker.y);
+        }
+        for(Chunk *c : map.resident()) {
+            if(c != nullptr) {
+                mismatches += pool.get(handles.at(toKey(c->m_position.x, c->m_position.y))) != c;
+            }
+        }
+    }
+    size_t residentChunks = 0;
+    for(Chunk *c : map.resident()) {
+        residentChunks += c != nullptr;
+    }
+    // Where the walker sees Chunks, as tryExpansion leaves VBOs there
+    const glm::ivec2 zone(walker.x & ~63, walker.y & ~63);
+    auto inRange = [zone](const Chunk *c) {
+        return c->m_position.x >= zone.x - 128 && c->m_position.x < zone.x + 192
+            && c->m_position.y >= zone.y - 128 && c->m_position.y < zone.y + 192;
+    };
+
+    size_t sink = 0, visibleFromMap = 0, visibleFromGrid = 0;
+    const double iterateMap = timeIt([&]() {
+        visibleFromMap = 0;
+        for(auto &entry : handles) {
+            const Chunk *c = pool.get(entry.second);
+            visibleFromMap += inRange(c);
+        }
+    });
+    const double iterateGrid = timeIt([&]() {
+        visibleFromGrid = 0;
+        for(const Chunk *c : map.resident()) {
+            visibleFromGrid += c != nullptr && inRange(c);
+        }
+    });
+    const glm::ivec2 offsets[] = {{16, 0}, {-16, 0}, {0, 16}, {0, -16}};
+    const double neighborsHashed = timeIt([&]() {
+        for(const Chunk *c : map.resident()) {
+            if(c != nullptr) {
+                for(const glm::ivec2 &d : offsets) {
+                    auto it = handles.find(toKey(c->m_position.x + d.x, c->m_position.y + d.y));
+                    sink += it != handles.end() ? uintptr_t(pool.get(it->second)) & 1 : 0;
+                }
+            }
+        }
+    });
+    const double neighborsGrid = timeIt([&]() {
+        for(const Chunk *c : map.resident()) {
+            if(c != nullptr) {
+                for(const glm::ivec2 &d : offsets) {
+                    sink += uintptr_t(map.find(c->m_position.x + d.x, c->m_position.y + d.y)) & 1;
+                }
+            }
+        }
+    });
+
+    std::cout << "resident grid (" << handles.size() << " chunks after walking " << steps << " zones, "
+              << residentChunks << " of " << map.resident().size() << " grid slots filled, sum " << sink << ")\n"
+              << "  visiting the " << visibleFromGrid << " chunks in range: hash map " << iterateMap * 1e6
+              << " us, grid " << iterateGrid * 1e6 << " us (" << iterateMap / iterateGrid << "x), "
+              << (visibleFromMap == visibleFromGrid ? "same chunks" : "DIFFERENT chunks") << "\n"
+              << "  their 4 neighbors: hashed " << neighborsHashed * 1e6 << " us, grid "
+              << neighborsGrid * 1e6 << " us (" << neighborsHashed / neighborsGrid << "x)\n"
+              << "  grid slots after recentering " << (mismatches == 0 ? "match" : "DIFFER") << "\n";
+}
+
+// Worker threads querying Chunks and their neighbors by world coordinates
+// while Chunks come and go, as Terrain's workers do: through one
+// hash map behind a single QMutex, against a ChunkDirectory. Each thread
+// also inserts and erases Chunks of its own, which are checked at the end.
+static void benchChunkDirectory() {
+    const int threads = std::max(4u, std::thread::hardware_concurrency());
+    const int queries = 1 << 18;
+    ChunkPool pool(nullptr);
+    std::vector<Chunk*> world;
+    for(int x = -256; x < 256; x += 16) {
+        for(int z = -256; z < 256; z += 16) {
+            world.push_back(pool.get(pool.acquire()));
+            world.back()->m_position = glm::ivec2(x, z);
+        }
+    }
+    // Thread t inserts and erases Chunks in the row of zones at z = 512 + 64 * t
+    std::vector<Chunk*> extra(threads * 16);
+    for(Chunk *&c : extra) {
+        c = pool.get(pool.acquire());
+    }
+
+    QMutex globalLock;
+    std::unordered_map<int64_t, Chunk*> global;
+    ChunkDirectory directory;
+    auto run = [&](bool sharded) {
+        if(!sharded) {
+            global.clear();
+        }
+        for(Chunk *c : world) {
+            if(sharded) {
+                directory.insert(c->m_position.x, c->m_position.y, c);
+            } else {
+                global[toKey(c->m_position.x, c->m_position.y)] = c;
+            }
+        }
+        std::atomic<uint64_t> found(0);
+        auto worker = [&](int t) {
+            std::mt19937 rng(23 + t);
+            uint64_t hits = 0;
+            for(int i = 0; i < queries; i++) {
+                const int x = int(rng() % 512) - 256, z = int(rng() % 512) - 256;
+                const bool churn = i % 64 == 0;
+                const int cx = 16 * ((i / 64) % 16), cz = 512 + 64 * t;
+                Chunk *c = extra[16 * t + (i / 64) % 16];
+                for(int d = -16; d <= 16; d += 16) {
+                    if(sharded) {
+                        hits += directory.find(x + d, z) != nullptr;
+                    } else {
+                        QMutexLocker locker(&globalLock);
+                        hits += global.count(toKey((x + d) & ~15, z & ~15));
+                    }
+                }
+                if(churn) {
+                    // Even rounds insert the Chunk, odd ones erase it
+                    const bool insert = (i / 1024) % 2 == 0;
+                    if(sharded) {
+                        insert ? directory.insert(cx, cz, c) : (void)directory.erase(cx, cz);
+                    } else {
+                        QMutexLocker locker(&globalLock);
+                        insert ? (void)(global[toKey(cx, cz)] = c) : (void)global.erase(toKey(cx, cz));
+                    }
+                }
+            }
+            found += hits;
+        };
+        std::vector<std::thread> pool;
+        for(int t = 0; t < threads; t++) {
+            pool.emplace_back(worker, t);
+        }
+        for(std::thread &thread : pool) {
+            thread.join();
+        }
+        return found.load();
+    };
+
+    uint64_t globalFound = 0, shardedFound = 0;
+    const double tGlobal = timeIt([&]() { globalFound = run(false); });
+    const double tSharded = timeIt([&]() {
+        for(int x = -256; x < 256; x += 16) {
+            for(int z = -256; z < 256 + 64 * threads + 512; z += 16) {
+                directory.erase(x, z);
+            }
+        }
+        shardedFound = run(true);
+    });
+    // The last round of every thread erased its 16 Chunks again
+    const bool consistent = directory.size() == world.size() && global.size() == world.size();
+
+    const double total = 3.0 * queries * threads;
+    std::cout << "chunk directory (" << threads << " threads, " << world.size() << " chunks, "
+              << std::thread::hardware_concurrency() << " hardware threads)\n"
+              << "  one lock: " << total / tGlobal / 1e6 << " M queries/sec\n"
+              << "  " << ChunkDirectory::SHARDS << " shards: " << total / tSharded / 1e6 << " M queries/sec ("
+              << tGlobal / tSharded << "x)\n"
+              << "  chunks found " << (globalFound == shardedFound ? "match" : "DIFFER") << ", contents after churn "
+              << (consistent ? "match" : "DIFFER") << "\n";
+}
+
+// Walks the blocks of decoded Chunks, stored one 16^3 section after another
+// with each section in layout L, in the orders the game walks them in:
+// the mesher's x, z, y with all 6 neighbors of each block, horizontal
+// layers like carving, and writing whole columns like fillTerrain.
+// Besides the time, lines counts how often consecutive accesses of the
+// mesher's walk move to a different 64-byte cache line.
+template <typename L>
+static void benchLayoutWith(const std::vector<std::vector<BlockType>> &source) {
+    auto index = [](int x, int y, int z) { return L::index(x, y & 15, z) + 4096 * (y >> 4); };
+    std::vector<std::vector<BlockType>> chunks;
+    for(const std::vector<BlockType> &blocks : source) {
+        chunks.emplace_back(65536);
+        for(int x = 0; x < 16; x++) {
+            for(int y = 0; y < 256; y++) {
+                for(int z = 0; z < 16; z++) {
+                    chunks.back()[index(x, y, z)] = blocks[x + 16 * y + 4096 * z];
+                }
+            }
+        }
+    }
+
+    const int offsets[6][3] = {{1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1}};
+    uint64_t faces = 0, lines = 0;
+    int lastLine = -1;
+    double meshing = timeIt([&]() {
+        faces = 0;
+        for(const std::vector<BlockType> &blocks : chunks) {
+            for(int x = 0; x < 16; x++) {
+                for(int z = 0; z < 16; z++) {
+                    for(int y = 0; y < 256; y++) {
+                        if(blocks[index(x, y, z)] == EMPTY) {
+                            continue;
+                        }
+                        for(const int *o : offsets) {
+                            int nx = x + o[0], ny = y + o[1], nz = z + o[2];
+                            if(nx < 0 || nx > 15 || ny < 0 || ny > 255 || nz < 0 || nz > 15) {
+                                faces++;
+                            } else {
+                                faces += blocks[index(nx, ny, nz)] == EMPTY;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    });
+    // Counted separately so the bookkeeping does not skew the timing
+    for(int x = 0; x < 16; x++) {
+        for(int z = 0; z < 16; z++) {
+            for(int y = 0; y < 256; y++) {
+                for(int n = -1; n < 6; n++) {
+                    int nx = x, ny = y, nz = z;
+                    if(n >= 0) {
+                        nx += offsets[n][0], ny += offsets[n][1], nz += offsets[n][2];
+                    }
+                    if(nx >= 0 && nx <= 15 && ny >= 0 && ny <= 255 && nz >= 0 && nz <= 15) {
+                        int line = index(nx, ny, nz) / 64;
+                        lines += line != lastLine;
+                        lastLine = line;
+                    }
+                }
+            }
+        }
+    }
+
+    uint64_t stone = 0;
+    double layers = timeIt([&]() {
+        stone = 0;
+        for(const std::vector<BlockType> &blocks : chunks) {
+            for(int y = 0; y < 256; y++) {
+                for(int z = 0; z < 16; z++) {
+                    for(int x = 0; x < 16; x++) {
+                        stone += blocks[index(x, y, z)] == STONE;
+                    }
+                }
+            }
+        }
+    });
+
+    double columns = timeIt([&]() {
+        for(std::vector<BlockType> &blocks : chunks) {
+            for(int x = 0; x < 16; x++) {
+                for(int z = 0; z < 16; z++) {
+                    for(int y = 1; y < 128; y++) {
+                        blocks[index(x, y, z)] = STONE;
+                    }
+                }
+            }
+        }
+    });
+
+    std::cout << "  " << L::NAME << "\n"
+              << "    meshing walk: " << chunks.size() / meshing << " chunks/sec, "
+              << lines << " cache line changes per chunk (" << faces << " faces)\n"
+              << "    layers: " << chunks.size() / layers << " chunks/sec (" << stone << " stone)\n"
+              << "    column fills: " << chunks.size() / columns << " chunks/sec\n";
+}
+
+// The block layouts of blocklayout.h against each other, over 64 Chunks
+// of generated terrain, which is far more than fits in the L2 cache
+static void benchLayout() {
+    std::vector<std::vector<BlockType>> chunks;
+    for(int zone = 0; zone < 4; zone++) {
+        glm::ivec2 zonePos(zone * 64 - 1024, 512);
+        ZoneMap zoneMap(zonePos);
+        for(int x = 0; x < 64; x += 16) {
+            for(int z = 0; z < 64; z += 16) {
+                Chunk chunk(nullptr);
+                chunk.GenerateChunkAt(zonePos + glm::ivec2(x, z), zoneMap);
+                chunks.emplace_back(65536);
+                for(int bx = 0; bx < 16; bx++) {
+                    for(int y = 0; y < 256; y++) {
+                        for(int bz = 0; bz < 16; bz++) {
+                            chunks.back()[bx + 16 * y + 4096 * bz] = chunk.getBlockAt(bx, y, bz);
+                        }
+                    }
+                }
+            }
+        }
+    }
+    std::cout << "block layouts (" << chunks.size() << " chunks, built with " << BlockLayout::NAME << ")\n";
+    benchLayoutWith<ColumnLayout>(chunks);
+    benchLayoutWith<XYZLayout>(chunks);
+    benchLayoutWith<XZYLayout>(chunks);
+    benchLayoutWith<MortonLayout>(chunks);
+}
+
+// Evicting the middle one of 3 x 3 zones and bringing it back, as Terrain
+// does once it exceeds its memory budget. Unedited, the zone is generated
+// again, which must give the same blocks as before even though its
+// neighbors are finished and do not decorate again. Edited, it is saved
+// and loaded with the world file format instead, and the zones around it
+// must still line up with it.
+static void benchEviction() {
+    const glm::ivec2 origin(-4096, 4096);
+    const glm::ivec2 middle = origin + glm::ivec2(64, 64);
+    std::unordered_map<int64_t, uPtr<Chunk>> chunks;
+    std::vector<Chunk*> finished;
+    QMutex finishedLock;
+    GenerationPipeline pipeline(QThreadPool::globalInstance(), [&](Chunk *c) {
+        finishedLock.lock();
+        finished.push_back(c);
+        finishedLock.unlock();
+    });
+    auto chunkAt = [&](int x, int z) -> Chunk* {
+        auto it = chunks.find(toKey(x, z));
+        return it != chunks.end() ? it->second.get() : nullptr;
+    };
+    auto makeZone = [&](glm::ivec2 zonePos) {
+        std::vector<Chunk*> zone;
+        for(int x = zonePos.x; x < zonePos.x + 64; x += 16) {
+            for(int z = zonePos.y; z < zonePos.y + 64; z += 16) {
+                uPtr<Chunk> &c = chunks[toKey(x, z)];
+                c = mkU<Chunk>(nullptr);
+                c->m_position = glm::ivec2(x, z);
+                c->linkNeighbor(chunkAt(x, z + 16), ZPOS);
+                c->linkNeighbor(chunkAt(x, z - 16), ZNEG);
+                c->linkNeighbor(chunkAt(x + 16, z), XPOS);
+                c->linkNeighbor(chunkAt(x - 16, z), XNEG);
+                zone.push_back(c.get());
+            }
+        }
+        return zone;
+    };
+    auto evict = [&](glm::ivec2 zonePos) {
+        if(!pipeline.removeZone(zonePos)) {
+            std::cout << "  zone still busy after waitForIdle!\n";
+        }
+        for(int x = zonePos.x; x < zonePos.x + 64; x += 16) {
+            for(int z = zonePos.y; z < zonePos.y + 64; z += 16) {
+                chunkAt(x, z)->unlinkNeighbors();
+                chunks.erase(toKey(x, z));
+            }
+        }
+        finished.clear();
+    };
+    std::vector<BlockType> before(16 * 65536), after(16 * 65536);
+    auto decodeMiddle = [&](std::vector<BlockType> &out) {
+        for(int i = 0; i < 16; i++) {
+            chunkAt(middle.x + 16 * (i / 4), middle.y + 16 * (i % 4))->decodeBlocks(out.data() + 65536 * i);
+        }
+    };
+    auto differing = [&]() {
+        decodeMiddle(after);
+        int count = 0;
+        for(size_t i = 0; i < before.size(); i++) {
+            count += before[i] != after[i];
+        }
+        return count;
+    };
+
+    for(int x = 0; x < 3; x++) {
+        for(int z = 0; z < 3; z++) {
+            glm::ivec2 zonePos = origin + glm::ivec2(64 * x, 64 * z);
+            pipeline.addZone(zonePos, makeZone(zonePos));
+        }
+    }
+    pipeline.waitForIdle();
+    decodeMiddle(before);
+    size_t zoneBytes = 0;
+    for(int i = 0; i < 16; i++) {
+        zoneBytes += sizeof(Chunk) + chunkAt(middle.x + 16 * (i / 4), middle.y + 16 * (i % 4))->blockBytes();
+    }
+
+    using clock = std::chrono::steady_clock;
+    evict(middle);
+    auto start = clock::now();
+    pipeline.addZone(middle, makeZone(middle));
+    pipeline.waitForIdle();
+    const double regenerated = std::chrono::duration<double>(clock::now() - start).count();
+    const int regeneratedDiffering = differing();
+    // The 16 Chunks of the zone plus the 16 around it, which lost
+    // an edge neighbor while it was gone
+    const size_t notified = finished.size();
+
+    for(int i = 0; i < 16; i++) {
+        chunkAt(middle.x + 16 * (i / 4), middle.y + 16 * (i % 4))->setBlockAt(8u, 200u, 8u, STONE);
+    }
+    decodeMiddle(before);
+    const std::string path = "eviction_benchmark.mmcw";
+    std::vector<const Chunk*> zone;
+    for(int i = 0; i < 16; i++) {
+        zone.push_back(chunkAt(middle.x + 16 * (i / 4), middle.y + 16 * (i % 4)));
+    }
+    start = clock::now();
+    const bool saved = writeWorldFile(path, zone);
+    const double saving = std::chrono::duration<double>(clock::now() - start).count();
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    const long long fileBytes = file ? static_cast<long long>(file.tellg()) : 0;
+    file.close();
+
+    evict(middle);
+    start = clock::now();
+    std::vector<Chunk*> loadedZone = makeZone(middle);
+    // The file is read on a worker, as Terrain does
+    std::unordered_map<int64_t, Chunk*> byCorner;
+    for(Chunk *c : loadedZone) {
+        byCorner[toKey(c->m_position.x, c->m_position.y)] = c;
+    }
+    // The pipeline makes the zone's Chunks with this, as Terrain's
+    // workers do, but here they are made beforehand
+    auto premade = [&](glm::ivec2 pos) { return byCorner.at(toKey(pos.x, pos.y)); };
+    bool loaded = false;
+    auto load = [&](const std::vector<Chunk*> &) {
+        std::vector<Chunk*> filled;
+        loaded = readWorldFile(path, [&](glm::ivec2 pos) {
+            auto it = byCorner.find(toKey(pos.x, pos.y));
+            if(it == byCorner.end()) {
+                return static_cast<Chunk*>(nullptr);
+            }
+            filled.push_back(it->second);
+            return it->second;
+        });
+        if(!loaded) {
+            filled.clear();
+        }
+        for(Chunk *c : filled) {
+            c->compactBlocks();
+        }
+        return filled;
+    };
+    pipeline.addLoadedZone(middle, premade, load);
+    pipeline.waitForIdle();
+    const double loading = std::chrono::duration<double>(clock::now() - start).count();
+
+    const int loadedDiffering = saved && loaded ? differing() : -1;
+    const size_t notifiedAfterLoad = finished.size();
+
+    // The seam between the edited zone and the one east of it, after both
+    // were evicted. The edited zone is saved without one Chunk on that
+    // border, as if it had not finished, and the east zone is generated
+    // again. Both must get the trees and veins the other spills over the
+    // seam, just like a fresh generation.
+    const glm::ivec2 east = middle + glm::ivec2(64, 0);
+    const glm::ivec2 unsaved = middle + glm::ivec2(48, 16);
+    chunkAt(unsaved.x, unsaved.y)->setBlockAt(8u, 200u, 8u, EMPTY);
+    std::vector<BlockType> seamBefore(20 * 65536), seamAfter(20 * 65536);
+    auto decodeSeam = [&](std::vector<BlockType> &out) {
+        for(int i = 0; i < 16; i++) {
+            chunkAt(middle.x + 16 * (i / 4), middle.y + 16 * (i % 4))->decodeBlocks(out.data() + 65536 * i);
+        }
+        for(int i = 0; i < 4; i++) {
+            chunkAt(east.x, east.y + 16 * i)->decodeBlocks(out.data() + 65536 * (16 + i));
+        }
+    };
+    decodeSeam(seamBefore);
+    zone.clear();
+    for(Chunk *c : loadedZone) {
+        if(c->m_position != unsaved) {
+            zone.push_back(c);
+        }
+    }
+    const bool savedSeam = writeWorldFile(path, zone);
+    evict(middle);
+    evict(east);
+    loadedZone = makeZone(middle);
+    byCorner.clear();
+    for(Chunk *c : loadedZone) {
+        byCorner[toKey(c->m_position.x, c->m_position.y)] = c;
+    }
+    pipeline.addLoadedZone(middle, premade, load);
+    pipeline.addZone(east, makeZone(east));
+    pipeline.waitForIdle();
+    std::remove(path.c_str());
+    int seamDiffering = -1;
+    if(savedSeam && loaded) {
+        decodeSeam(seamAfter);
+        seamDiffering = 0;
+        for(size_t i = 0; i < seamBefore.size(); i++) {
+            seamDiffering += seamBefore[i] != seamAfter[i];
+        }
+    }
+
+    // Nothing the pipeline holds for the zones should outlive them
+    const size_t pipelineBytes = pipeline.memoryBytes();
+    for(int x = 0; x < 3; x++) {
+        for(int z = 0; z < 3; z++) {
+            evict(origin + glm::ivec2(64 * x, 64 * z));
+        }
+    }
+
+    std::cout << "zone eviction (the middle one of 3 x 3 zones)\n"
+              << "  resident: " << zoneBytes / 1024.0 << " KiB per zone\n"
+              << "  generated again: " << regenerated * 1e3 << " ms, blocks differing from before eviction "
+              << regeneratedDiffering << ", chunks meshable again " << notified << "\n"
+              << "  edited: saved in " << saving * 1e3 << " ms to " << fileBytes / 1024.0 << " KiB, loaded in "
+              << loading * 1e3 << " ms, blocks differing from before eviction "
+              << loadedDiffering << ", chunks meshable again " << notifiedAfterLoad << "\n"
+              << "  edited and east neighbor both evicted, with 15 Chunks saved: blocks on the seam differing "
+              << "from before eviction " << seamDiffering << "\n"
+              << "  generation memory: " << pipelineBytes / 1024.0 << " KiB for 3 x 3 zones, "
+              << pipeline.memoryBytes() << " bytes left after evicting them all\n";
+}
+
+struct Benchmark {
+    const char *name;
+    void (*run)();
+};
+
+static const Benchmark benchmarks[] = {
+    {"columnnoise", benchColumnNoise},
+    {"noisehash", benchNoiseHash},
+    {"caves", benchCaves},
+    {"chunkgen", benchChunkGen},
+    {"pipeline", benchPipeline},
+    {"meshing", benchMeshing},
+    {"facemasks", benchFaceMasks},
+    {"greedy", benchGreedy},
+    {"packedvertices", benchPackedVertices},
+    {"heights", benchHeights},
+    {"chunkmemory", benchChunkMemory},
+    {"blockmemory", benchBlockMemory},
+    {"layout", benchLayout},
+    {"chunkpool", benchChunkPool},
+    {"chunklookup", benchChunkLookup},
+    {"residentgrid", benchResidentGrid},
+    {"chunkdirectory", benchChunkDirectory},
+    {"eviction", benchEviction},
+};
+
+int main(int argc, char *argv[]) {
+    for(const Benchmark &b : benchmarks) {
+        bool selected = argc < 2;
+        for(int i = 1; i < argc; i++) {
+            selected |= std::strcmp(argv[i], b.name) == 0;
+        }
+        if(selected) {
+            b.run();
+        }
+    }
+    return 0;
+}
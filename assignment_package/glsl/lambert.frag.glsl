@@ -20,6 +20,7 @@ in vec4 fs_Nor;
 in vec4 fs_LightVec;
 in vec4 fs_Col;
 in vec4 fs_UV;
+flat in vec3 fs_Tile;
 
 uniform sampler2D u_Texture;
 uniform int u_Time;
@@ -28,9 +29,22 @@ uniform int u_Time;
 out vec4 out_Col; // This is the final output color that you will see on your
                   // screen for the pixel that is currently being processed.
 
+// The same xxHash32-style integer hash as hashCoords() in noise.cpp
+// (with seed 0), so it stays stable far away from the origin
+uint hashRound(uint h, uint v) {
+    h += v * 0xC2B2AE3Du;
+    return ((h << 17) | (h >> 15)) * 0x27D4EB2Fu;
+}
+
 float random1(vec3 p) {
-    return fract(sin(dot(p,vec3(127.1, 311.7, 191.999)))
-                 *43758.5453);
+    ivec3 i = ivec3(floor(p));
+    uint h = hashRound(hashRound(hashRound(0x165667B1u, uint(i.x)), uint(i.y)), uint(i.z));
+    h ^= h >> 15;
+    h *= 0x85EBCA77u;
+    h ^= h >> 13;
+    h *= 0xC2B2AE3Du;
+    h ^= h >> 16;
+    return float(h >> 8) / 16777216.0;
 }
 
 float mySmoothStep(float a, float b, float t) {
@@ -90,6 +104,10 @@ void main()
         // Compute final shaded color
 
         vec2 color = vec2(fs_UV);
+        // Repeat the tile across merged faces
+        if (fs_Tile.z > 0) {
+            color = fs_Tile.xy + fract(color) / 16;
+        }
         vec2 offset = vec2(0, 0);
         float pct = u_Time / 8000.f;
 
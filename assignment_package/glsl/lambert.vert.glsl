@@ -28,30 +28,64 @@ in vec4 vs_Nor;             // The array of vertex normals passed to the shader
 
 in vec4 vs_Col;             // The array of vertex colors passed to the shader.
 in vec4 vs_UV;
+in uvec2 vs_Packed;         // Chunk vertices in VertexFormat::Packed, which replace the three above when
+                            // u_Packed is set. See packVertex in chunk.cpp for the bits.
+uniform int u_Packed;
 
 out vec4 fs_Pos;
 out vec4 fs_UV;
 out vec4 fs_Nor;            // The array of normals that has been transformed by u_ModelInvTr. This is implicitly passed to the fragment shader.
 out vec4 fs_LightVec;       // The direction in which our virtual light lies, relative to each vertex. This is implicitly passed to the fragment shader.
 out vec4 fs_Col;            // The color of each vertex. This is implicitly passed to the fragment shader.
+flat out vec3 fs_Tile;      // For greedy chunk meshes, the atlas UV of the tile to repeat across the
+                            // face, and 1 in z. All 0 for everything else.
+
+const vec3 directions[6] = vec3[6](vec3(1, 0, 0), vec3(-1, 0, 0), vec3(0, 1, 0),
+                                   vec3(0, -1, 0), vec3(0, 0, 1), vec3(0, 0, -1));
 
 const vec4 lightDir = normalize(vec4(0.5, 1, 0.75, 0));  // The direction of our virtual light, which is used to compute the shading of
                                         // the geometry in the fragment shader.
 
 void main()
 {
-    fs_Pos = vs_Pos;
-    fs_UV = vs_UV;                         // Pass the vertex colors to the fragment shader for interpolation
+    vec4 pos = vs_Pos;
+    vec4 nor = vs_Nor;
+    vec4 uv = vs_UV;
+    // Rebuild the same three vec4s the unpacked format would have
+    if(u_Packed != 0) {
+        uint geometry = vs_Packed.x;
+        uint material = vs_Packed.y;
+        pos = vec4(geometry & 31u, (geometry >> 5) & 511u, (geometry >> 14) & 31u, 1);
+        float tile = float(material & 255u);
+        vec2 corner = vec2(material >> 8 & 31u, material >> 13 & 511u);
+        bool tiled = (material & (1u << 23)) != 0u;
+        nor = vec4(directions[int(geometry >> 19 & 7u)], tiled ? 2.0 + tile : 1.0);
+        uv.xy = tiled ? corner : (vec2(mod(tile, 16), floor(tile / 16)) + corner) / 16;
+        uv.z = (material & (1u << 22)) != 0u ? 0.0 : 1.0;
+        uv.w = float(material >> 24) / 255;
+    }
+
+    fs_Pos = pos;
+    fs_UV = uv;                            // Pass the vertex colors to the fragment shader for interpolation
+
+    // Greedy chunk meshes set the normal's w to 2 plus the tile's index in
+    // the 16 x 16 atlas, and give UVs in tiles from the quad's corner
+    if(nor.w >= 2) {
+        float tile = nor.w - 2;
+        fs_Tile = vec3(mod(tile, 16) / 16, floor(tile / 16) / 16, 1);
+    } else {
+        fs_Tile = vec3(0);
+    }
 
     mat3 invTranspose = mat3(u_ModelInvTr);
-    fs_Nor = vec4(invTranspose * vec3(vs_Nor), 0);          // Pass the vertex normals to the fragment shader for interpolation.
+    fs_Nor = vec4(invTranspose * vec3(nor), 0);          // Pass the vertex normals to the fragment shader for interpolation.
                                                             // Transform the geometry's normals by the inverse transpose of the
                                                             // model matrix. This is necessary to ensure the normals remain
                                                             // perpendicular to the surface after the surface is transformed by
                                                             // the model matrix.
 
 
-    vec4 modelposition = u_Model * vs_Pos;   // Temporarily store the transformed vertex positions for use below
+    vec4 modelposition = u_Model * pos;   // Temporarily store the transformed vertex positions for use below
 
     fs_LightVec = (lightDir);  // Compute the direction in which the light source lies
 
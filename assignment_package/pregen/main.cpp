@@ -0,0 +1,151 @@
+#include "scene/chunk.h"
+#include "scene/generationpipeline.h"
+#include "scene/noise.h"
+#include "scene/worldfile.h"
+#include "scene/zonemap.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+static void usage() {
+    std::cerr << "usage: MiniMinecraftPregen <zones per side> [--origin x z] [--seed n]\n"
+                 "                           [--threads n] [--out prefix]\n"
+                 "Generates the square of zones whose lower-left zone contains the\n"
+                 "origin block (0 0 by default), and optionally saves each zone to\n"
+                 "prefix_<x>_<z>.mmcw, where MiniMinecraft --world prefix loads it.\n";
+}
+
+// The lower-left corner of the zone containing a block
+static int zoneCoord(int x) {
+    return x >= 0 ? x / 64 * 64 : (x - 63) / 64 * 64;
+}
+
+int main(int argc, char *argv[]) {
+    if(argc < 2 || std::atoi(argv[1]) <= 0) {
+        usage();
+        return 1;
+    }
+    const int zonesPerSide = std::atoi(argv[1]);
+    glm::ivec2 origin(0, 0);
+    std::string outPrefix;
+    for(int i = 2; i < argc; i++) {
+        if(std::strcmp(argv[i], "--origin") == 0 && i + 2 < argc) {
+            origin = glm::ivec2(zoneCoord(std::atoi(argv[i + 1])), zoneCoord(std::atoi(argv[i + 2])));
+            i += 2;
+        } else if(std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            setNoiseBackend({NoiseHash::Integer, static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10))});
+        } else if(std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            QThreadPool::globalInstance()->setMaxThreadCount(std::atoi(argv[++i]));
+        } else if(std::strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            outPrefix = argv[++i];
+        } else {
+            usage();
+            return 1;
+        }
+    }
+
+    // A Chunk only finishes once its neighbors have been decorated, so we
+    // also generate a ring of zones around the requested square. Those
+    // stop short of Finished and are neither counted nor saved.
+    std::vector<uPtr<Chunk>> chunks;
+    std::vector<const Chunk*> region;
+    std::vector<std::pair<glm::ivec2, std::vector<Chunk*>>> zones;
+    // The zones of the requested square, each saved to its own file
+    std::vector<std::pair<glm::ivec2, std::vector<const Chunk*>>> regionZones;
+    for(int zx = -1; zx <= zonesPerSide; zx++) {
+        for(int zz = -1; zz <= zonesPerSide; zz++) {
+            const bool inRegion = zx >= 0 && zz >= 0 && zx < zonesPerSide && zz < zonesPerSide;
+            glm::ivec2 zonePos = origin + glm::ivec2(zx * 64, zz * 64);
+            zones.push_back({zonePos, {}});
+            if(inRegion) {
+                regionZones.push_back({zonePos, {}});
+            }
+            for(int x = 0; x < 64; x += 16) {
+                for(int z = 0; z < 64; z += 16) {
+                    chunks.push_back(mkU<Chunk>(nullptr));
+                    chunks.back()->m_position = zonePos + glm::ivec2(x, z);
+                    zones.back().second.push_back(chunks.back().get());
+                    if(inRegion) {
+                        region.push_back(chunks.back().get());
+                        regionZones.back().second.push_back(chunks.back().get());
+                    }
+                }
+            }
+        }
+    }
+
+    std::cout << "generating " << zonesPerSide << " x " << zonesPerSide << " zones ("
+              << region.size() << " chunks) from " << origin.x << ", " << origin.y << " on "
+              << QThreadPool::globalInstance()->maxThreadCount() << " threads\n";
+
+    using clock = std::chrono::steady_clock;
+    std::array<StageTiming, GEN_STAGE_COUNT> timings;
+    auto start = clock::now();
+    {
+        GenerationPipeline pipeline(QThreadPool::globalInstance(), [](Chunk*) {});
+        for(const auto &zone : zones) {
+            pipeline.addZone(zone.first, zone.second);
+        }
+        pipeline.waitForIdle();
+        timings = pipeline.stageTimings();
+    }
+    const double seconds = std::chrono::duration<double>(clock::now() - start).count();
+
+    std::cout << "  " << seconds << " s, " << regionZones.size() / seconds << " zones/sec, "
+              << region.size() / seconds << " chunks/sec\n"
+              << "  (including the " << zones.size() - regionZones.size() << " zones of the surrounding ring: "
+              << zones.size() / seconds << " zones/sec)\n";
+    for(int i = 0; i < GEN_STAGE_COUNT; i++) {
+        const StageTiming &t = timings[i];
+        std::cout << "    " << genStageName(static_cast<GenStage>(i)) << ": " << t.tasks << " tasks, "
+                  << t.nanoseconds / 1e9 << " s total, "
+                  << (t.tasks ? t.nanoseconds / 1e6 / t.tasks : 0.0) << " ms each\n";
+    }
+
+    if(!outPrefix.empty()) {
+        start = clock::now();
+        for(const auto &zone : regionZones) {
+            if(!writeWorldFile(zoneFilePath(outPrefix, zone.first), zone.second)) {
+                std::cerr << "could not write " << zoneFilePath(outPrefix, zone.first) << "\n";
+                return 1;
+            }
+        }
+        std::cout << "  saved to " << zoneFilePath(outPrefix, regionZones.front().first) << " and "
+                  << regionZones.size() - 1 << " more in "
+                  << std::chrono::duration<double>(clock::now() - start).count() << " s\n";
+
+        // Load them back to check the files and to time loading against generating
+        std::vector<uPtr<Chunk>> loaded;
+        start = clock::now();
+        bool ok = true;
+        for(const auto &zone : regionZones) {
+            ok = ok && readWorldFile(zoneFilePath(outPrefix, zone.first), [&](glm::ivec2 pos) {
+                loaded.push_back(mkU<Chunk>(nullptr));
+                loaded.back()->m_position = pos;
+                return loaded.back().get();
+            });
+        }
+        const double loadSeconds = std::chrono::duration<double>(clock::now() - start).count();
+        int mismatches = loaded.size() == region.size() ? 0 : -1;
+        for(size_t i = 0; ok && mismatches >= 0 && i < loaded.size(); i++) {
+            for(int x = 0; x < 16; x++) {
+                for(int y = 0; y < 256; y++) {
+                    for(int z = 0; z < 16; z++) {
+                        mismatches += loaded[i]->getBlockAt(x, y, z) != region[i]->getBlockAt(x, y, z);
+                    }
+                }
+            }
+        }
+        if(!ok || mismatches != 0) {
+            std::cerr << "  " << outPrefix << "_*.mmcw do not match the generated chunks\n";
+            return 1;
+        }
+        std::cout << "  loaded back in " << loadSeconds << " s, "
+                  << loaded.size() / loadSeconds << " chunks/sec\n";
+    }
+    return 0;
+}
@@ -0,0 +1,49 @@
+# Headless world pregeneration. Generates a square of zones on every core
+# without opening a window or creating an OpenGL context, reports the
+# throughput, and can save the result for fast loading later, e.g.
+#   qmake pregen.pro && make && ./MiniMinecraftPregen 8 --out world
+# writes world_<x>_<z>.mmcw for each zone, which MiniMinecraft --world world
+# then loads instead of generating those zones.
+# Chunk derives from Drawable, so we link against the OpenGL classes
+# even though no context is ever created
+QT += widgets openglwidgets
+
+TARGET = MiniMinecraftPregen
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+CONFIG += c++1z
+CONFIG += release
+
+INCLUDEPATH += ../include ../src
+
+SOURCES += \
+    main.cpp \
+    ../src/drawable.cpp \
+    ../src/scene/cavefield.cpp \
+    ../src/scene/chunk.cpp \
+    ../src/scene/decorator.cpp \
+    ../src/scene/generationpipeline.cpp \
+    ../src/scene/noise.cpp \
+    ../src/scene/noisebatch.cpp \
+    ../src/scene/palettedblocks.cpp \
+    ../src/scene/stageworker.cpp \
+    ../src/scene/worldfile.cpp \
+    ../src/scene/zonemap.cpp
+
+HEADERS += \
+    ../src/drawable.h \
+    ../src/scene/blocklayout.h \
+    ../src/scene/blockregistry.h \
+    ../src/scene/cavefield.h \
+    ../src/scene/chunk.h \
+    ../src/scene/decorator.h \
+    ../src/scene/generationpipeline.h \
+    ../src/scene/noise.h \
+    ../src/scene/noisegraph.h \
+    ../src/scene/noisekernel.inl \
+    ../src/scene/palettedblocks.h \
+    ../src/scene/stageworker.h \
+    ../src/scene/terrainnoise.h \
+    ../src/scene/worldfile.h \
+    ../src/scene/zonemap.h
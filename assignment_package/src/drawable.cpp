@@ -53,6 +53,11 @@ GLenum Drawable::drawMode()
     return GL_TRIANGLES;
 }
 
+bool Drawable::packedVertices()
+{
+    return false;
+}
+
 int Drawable::elemCount()
 {
     return m_count;
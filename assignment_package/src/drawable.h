@@ -54,6 +54,9 @@ public:
 
     // Getter functions for various GL data
     virtual GLenum drawMode();
+    // Whether the interleaved opaque and transparent VBOs hold 2 uint32s
+    // per vertex, as Chunk's VertexFormat::Packed, instead of 3 vec4s
+    virtual bool packedVertices();
     int elemCount();
     // for transparent and opaque
     int elementTransCount();
@@ -18,6 +18,8 @@ MainWindow::MainWindow(QWidget *parent) :
     connect(ui->mygl, SIGNAL(sig_sendPlayerLook(QString)), &playerInfoWindow, SLOT(slot_setLookText(QString)));
     connect(ui->mygl, SIGNAL(sig_sendPlayerChunk(QString)), &playerInfoWindow, SLOT(slot_setChunkText(QString)));
     connect(ui->mygl, SIGNAL(sig_sendPlayerTerrainZone(QString)), &playerInfoWindow, SLOT(slot_setZoneText(QString)));
+    connect(ui->mygl, SIGNAL(sig_sendCaveStats(QString)), &playerInfoWindow, SLOT(slot_setCaveText(QString)));
+    connect(ui->mygl, SIGNAL(sig_sendMeshStats(QString)), &playerInfoWindow, SLOT(slot_setMeshText(QString)));
 }
 
 MainWindow::~MainWindow()
@@ -1,5 +1,6 @@
 #include "mygl.h"
 #include <glm_includes.h>
+#include "scene/cavefield.h"
 
 #include <iostream>
 #include <QApplication>
@@ -12,7 +13,8 @@ MyGL::MyGL(QWidget *parent)
       m_texture(nullptr), m_time(0.f),
       m_progLambert(this), m_progFlat(this), m_progInstanced(this), m_progSky(this),
       m_snowInstanced(this),
-      m_terrain(this), m_player(glm::vec3(48.f, 156.f, 48.f), m_terrain), previousFrame(QDateTime::currentMSecsSinceEpoch()), currentFrame(QDateTime::currentMSecsSinceEpoch())
+      m_terrain(this), m_player(glm::vec3(48.f, 156.f, 48.f), m_terrain), previousFrame(QDateTime::currentMSecsSinceEpoch()), currentFrame(QDateTime::currentMSecsSinceEpoch()),
+      m_frameMs(0.f)
 {
     // Connect the timer to a function so that when the timer ticks the function is executed
     connect(&m_timer, SIGNAL(timeout()), this, SLOT(tick()));
@@ -22,6 +24,13 @@ MyGL::MyGL(QWidget *parent)
 
     setMouseTracking(true); // MyGL will track the mouse's movements even if a mouse button is not pressed
     setCursor(Qt::BlankCursor); // Make the cursor invisible
+
+    // --world prefix plays in the zones MiniMinecraftPregen --out prefix saved
+    const QStringList args = QCoreApplication::arguments();
+    const int world = args.indexOf("--world");
+    if(world >= 0 && world + 1 < args.size()) {
+        m_terrain.setWorldPrefix(args[world + 1].toStdString());
+    }
 }
 
 MyGL::~MyGL() {
@@ -137,6 +146,7 @@ void MyGL::tick() {
     m_player.mcr_prevPos = m_player.mcr_position;
     this->currentFrame = QDateTime::currentMSecsSinceEpoch();
     float dT = (currentFrame - previousFrame) / 10.f;
+    m_frameMs += 0.05f * ((currentFrame - previousFrame) - m_frameMs);
     this->m_player.tick(dT, this->m_inputs);
     // reset inputs delta_x and delta_y to be zero
     this->resetMouseDelta();
@@ -152,10 +162,22 @@ void MyGL::sendPlayerDataToGUI() const {
     emit sig_sendPlayerAcc(m_player.accAsQString());
     emit sig_sendPlayerLook(m_player.lookAsQString());
     glm::vec2 pPos(m_player.mcr_position.x, m_player.mcr_position.z);
-    glm::ivec2 chunk(16 * glm::ivec2(glm::floor(pPos / 16.f)));
-    glm::ivec2 zone(64 * glm::ivec2(glm::floor(pPos / 64.f)));
+    glm::ivec2 block(glm::floor(pPos));
+    glm::ivec2 chunk(ChunkMap::chunkOrigin(block.x), ChunkMap::chunkOrigin(block.y));
+    glm::ivec2 zone(block.x & ~63, block.y & ~63);
     emit sig_sendPlayerChunk(QString::fromStdString("( " + std::to_string(chunk.x) + ", " + std::to_string(chunk.y) + " )"));
     emit sig_sendPlayerTerrainZone(QString::fromStdString("( " + std::to_string(zone.x) + ", " + std::to_string(zone.y) + " )"));
+    CaveStats caves = caveStats();
+    if(caves.chunks > 0) {
+        emit sig_sendCaveStats(QString::number(caves.nanoseconds / 1e6 / caves.chunks, 'f', 3) + " ms/chunk over "
+                               + QString::number(caves.chunks) + " chunks");
+    }
+    MeshStats mesh = m_terrain.meshStats();
+    emit sig_sendMeshStats(QString(Chunk::meshingMode() == MeshingMode::Greedy ? "greedy, " : "naive, ")
+                           + (Chunk::vertexFormat() == VertexFormat::Packed ? "packed, " : "float, ")
+                           + QString::number(mesh.vertices) + " verts, "
+                           + QString::number(mesh.bytes / 1024) + " KiB, "
+                           + QString::number(m_frameMs, 'f', 1) + " ms/frame");
 }
 
 // This function is called whenever update() is called.
@@ -282,6 +304,12 @@ void MyGL::keyReleaseEvent(QKeyEvent *e) {
         } else {
             this->m_inputs.flightMode = false;
         }
+    } else if (e->key() == Qt::Key_G) {
+        m_terrain.setMeshingMode(Chunk::meshingMode() == MeshingMode::Naive
+                                 ? MeshingMode::Greedy : MeshingMode::Naive);
+    } else if (e->key() == Qt::Key_V) {
+        m_terrain.setVertexFormat(Chunk::vertexFormat() == VertexFormat::Packed
+                                  ? VertexFormat::Float : VertexFormat::Packed);
     }
 }
 
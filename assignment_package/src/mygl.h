@@ -43,6 +43,7 @@ private:
     void sendPlayerDataToGUI() const;
     qint64 previousFrame;
     qint64 currentFrame;
+    float m_frameMs; // Time between ticks, averaged over roughly the last 20 frames
     QPoint global = mapToGlobal(QPoint(width() / 2.f, height() / 2.f));
 
     std::vector<std::shared_ptr<Texture>> shared_texture;
@@ -96,6 +97,8 @@ signals:
     void sig_sendPlayerLook(QString) const;
     void sig_sendPlayerChunk(QString) const;
     void sig_sendPlayerTerrainZone(QString) const;
+    void sig_sendCaveStats(QString) const;
+    void sig_sendMeshStats(QString) const;
 };
 
 
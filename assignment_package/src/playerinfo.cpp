@@ -36,3 +36,10 @@ void PlayerInfo::slot_setZoneText(QString s) {
     ui->zoneLabel->setText(s);
 }
 
+void PlayerInfo::slot_setCaveText(QString s) {
+    ui->caveLabel->setText(s);
+}
+
+void PlayerInfo::slot_setMeshText(QString s) {
+    ui->meshLabel->setText(s);
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+// How the 16 x 16 x 16 blocks of a Chunk section are ordered in memory.
+// Each layout maps local coordinates (x, y, z), all 0 to 15, to an index
+// from 0 to 4095. Y_STRIDE is the distance between vertically adjacent
+// blocks, or 0 if that is not constant.
+//
+// The layout is chosen at compile time by defining one of
+//   BLOCK_LAYOUT_XYZ     x + 16 * y + 256 * z, our original order
+//   BLOCK_LAYOUT_XZY     x + 16 * z + 256 * y, one horizontal layer after
+//                        another, the order caves are carved in
+//   BLOCK_LAYOUT_MORTON  the bits of x, y and z interleaved, so blocks
+//                        close in all three axes are close in memory
+// (e.g. DEFINES += BLOCK_LAYOUT_MORTON in the .pro file), and defaults to
+// ColumnLayout: y + 16 * z + 256 * x, one column after another. That is the
+// order the mesher and the column fills of generation walk in, so both read
+// and write memory contiguously. See the "layout" benchmark.
+
+// One vertical run of 16 blocks after another
+struct ColumnLayout {
+    static constexpr const char *NAME = "column (y innermost)";
+    static constexpr int Y_STRIDE = 1;
+    static constexpr int index(int x, int y, int z) { return y + 16 * z + 256 * x; }
+};
+
+struct XYZLayout {
+    static constexpr const char *NAME = "xyz (x innermost)";
+    static constexpr int Y_STRIDE = 16;
+    static constexpr int index(int x, int y, int z) { return x + 16 * y + 256 * z; }
+};
+
+// One horizontal 16 x 16 layer after another
+struct XZYLayout {
+    static constexpr const char *NAME = "xzy (layers)";
+    static constexpr int Y_STRIDE = 256;
+    static constexpr int index(int x, int y, int z) { return x + 16 * z + 256 * y; }
+};
+
+// Z-order: bit i of x, y and z ends up at bits 3i, 3i + 1 and 3i + 2
+struct MortonLayout {
+    static constexpr const char *NAME = "morton";
+    static constexpr int Y_STRIDE = 0;
+    // Spreads the 4 bits of v three bits apart
+    static constexpr int spread(int v) {
+        return (v & 1) | ((v & 2) << 2) | ((v & 4) << 4) | ((v & 8) << 6);
+    }
+    static constexpr int index(int x, int y, int z) { return spread(x) | spread(y) << 1 | spread(z) << 2; }
+};
+
+#if defined(BLOCK_LAYOUT_XYZ)
+typedef XYZLayout BlockLayout;
+#elif defined(BLOCK_LAYOUT_XZY)
+typedef XZYLayout BlockLayout;
+#elif defined(BLOCK_LAYOUT_MORTON)
+typedef MortonLayout BlockLayout;
+#else
+typedef ColumnLayout BlockLayout;
+#endif
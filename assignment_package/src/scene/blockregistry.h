@@ -0,0 +1,94 @@
+#pragma once
+#include "glm_includes.h"
+#include <array>
+
+// C++ 11 allows us to define the size of an enum. This lets us use only one byte
+// of memory to store our different block types. By default, the size of a C++ enum
+// is that of an int (so, usually four bytes). This *does* limit us to only 256 different
+// block types, but in the scope of this project we'll never get anywhere near that many.
+enum BlockType : unsigned char
+{
+    EMPTY, GRASS, DIRT, STONE, WATER, LAVA, BEDROCK, SAND, SNOW, WOOD, LEAF, COAL
+};
+
+constexpr int BLOCK_TYPE_COUNT = COAL + 1;
+
+// The six cardinal directions in 3D space
+enum Direction : unsigned char
+{
+    XPOS, XNEG, YPOS, YNEG, ZPOS, ZNEG
+};
+
+// Everything the game needs to know about one kind of block.
+// There is a single, read-only copy of this for each BlockType.
+struct BlockInfo {
+    // The texture atlas tile shown on each face, as (column, row)
+    // from the atlas' lower-left corner, indexed by Direction
+    unsigned char faceTiles[6][2];
+    // Hides the faces of the blocks next to it
+    bool opaque;
+    // Drawn in the transparent pass, after all opaque blocks
+    bool transparent;
+    // Its texture scrolls over time
+    bool animated;
+    // The alpha it is drawn with
+    float alpha;
+    // How much light it gives off, from 0 to 15
+    unsigned char emissive;
+    // The player collides with it. Liquids count as solid
+    // until the player is able to swim.
+    bool collides;
+};
+
+// A block with the same tile on all six faces
+constexpr BlockInfo uniformBlock(unsigned char col, unsigned char row, bool opaque = true, bool transparent = false,
+                                 bool animated = false, float alpha = 1.f, unsigned char emissive = 0) {
+    return {{{col, row}, {col, row}, {col, row}, {col, row}, {col, row}, {col, row}},
+            opaque, transparent, animated, alpha, emissive, true};
+}
+
+// A block whose sides, top and bottom differ
+constexpr BlockInfo sidedBlock(unsigned char sideCol, unsigned char sideRow, unsigned char topCol,
+                               unsigned char topRow, unsigned char bottomCol, unsigned char bottomRow) {
+    return {{{sideCol, sideRow}, {sideCol, sideRow}, {topCol, topRow},
+             {bottomCol, bottomRow}, {sideCol, sideRow}, {sideCol, sideRow}},
+            true, false, false, 1.f, 0, true};
+}
+
+// Indexed by BlockType
+constexpr std::array<BlockInfo, BLOCK_TYPE_COUNT> BLOCK_REGISTRY = {{
+    // EMPTY
+    {{{0, 0}, {0, 0}, {0, 0}, {0, 0}, {0, 0}, {0, 0}}, false, false, false, 0.f, 0, false},
+    // GRASS
+    sidedBlock(3, 15, 8, 13, 2, 15),
+    // DIRT
+    uniformBlock(2, 15),
+    // STONE
+    uniformBlock(1, 15),
+    // WATER, whose ZNEG face has always used the tile two to the right
+    {{{13, 3}, {13, 3}, {13, 3}, {13, 3}, {13, 3}, {15, 3}}, false, true, true, 0.8f, 0, true},
+    // LAVA
+    uniformBlock(14, 1, true, false, true, 1.f, 15),
+    // BEDROCK, which has no tile of its own yet
+    uniformBlock(1, 15),
+    // SAND
+    uniformBlock(2, 14),
+    // SNOW
+    uniformBlock(2, 11),
+    // WOOD
+    sidedBlock(4, 14, 5, 14, 5, 14),
+    // LEAF
+    uniformBlock(4, 12),
+    // COAL
+    uniformBlock(2, 13)
+}};
+
+constexpr const BlockInfo& blockInfo(BlockType t) {
+    return BLOCK_REGISTRY[t];
+}
+
+// The atlas UV of the lower-left corner of t's tile on the given face
+inline glm::vec2 faceUV(BlockType t, Direction d) {
+    const unsigned char *tile = BLOCK_REGISTRY[t].faceTiles[d];
+    return glm::vec2(tile[0] / 16.f, tile[1] / 16.f);
+}
@@ -0,0 +1,72 @@
+#include "cavefield.h"
+#include "noise.h"
+#include <algorithm>
+#include <atomic>
+
+// Caves are stretched horizontally so they form tunnels rather than blobs
+static const float HORIZONTAL_SCALE = 1.f / 32.f;
+static const float VERTICAL_SCALE = 1.f / 16.f;
+static const float CAVE_THRESHOLD = -0.25f;
+
+CaveField::CaveField(glm::ivec2 chunkPos)
+    : m_planes()
+{
+    for(int ly = 0; ly < POINTS_Y; ly++) {
+        // Sample this layer of the lattice...
+        float lattice[POINTS_XZ * POINTS_XZ];
+        for(int lz = 0; lz < POINTS_XZ; lz++) {
+            for(int lx = 0; lx < POINTS_XZ; lx++) {
+                glm::vec3 p((chunkPos.x + lx * CELL) * HORIZONTAL_SCALE,
+                            ly * CELL * VERTICAL_SCALE,
+                            (chunkPos.y + lz * CELL) * HORIZONTAL_SCALE);
+                lattice[lx + POINTS_XZ * lz] = perlinNoise3D(p);
+            }
+        }
+        // ...and spread it over all 16 x 16 columns
+        std::array<float, 256> &plane = m_planes[ly];
+        for(int z = 0; z < 16; z++) {
+            const int lz = z / CELL;
+            const float tz = (z % CELL) / float(CELL);
+            for(int x = 0; x < 16; x++) {
+                const int lx = x / CELL;
+                const float tx = (x % CELL) / float(CELL);
+                const float *row0 = lattice + POINTS_XZ * lz;
+                const float *row1 = row0 + POINTS_XZ;
+                const float d0 = row0[lx] + (row0[lx + 1] - row0[lx]) * tx;
+                const float d1 = row1[lx] + (row1[lx + 1] - row1[lx]) * tx;
+                plane[x + 16 * z] = d0 + (d1 - d0) * tz;
+            }
+        }
+    }
+}
+
+void CaveField::layer(int y, float *out) const {
+    const int ly = y / CELL;
+    const float *a = m_planes.at(ly).data();
+    if(y % CELL == 0) {
+        std::copy(a, a + 256, out);
+        return;
+    }
+    const float *b = m_planes.at(ly + 1).data();
+    const float t = (y % CELL) / float(CELL);
+    // Plain contiguous loop so the compiler can vectorize it
+    for(int i = 0; i < 256; i++) {
+        out[i] = a[i] + (b[i] - a[i]) * t;
+    }
+}
+
+bool CaveField::isCave(float density) {
+    return density < CAVE_THRESHOLD;
+}
+
+static std::atomic<uint64_t> g_caveChunks(0);
+static std::atomic<uint64_t> g_caveNanoseconds(0);
+
+void recordCaveTime(uint64_t nanoseconds) {
+    g_caveChunks++;
+    g_caveNanoseconds += nanoseconds;
+}
+
+CaveStats caveStats() {
+    return {g_caveChunks.load(), g_caveNanoseconds.load()};
+}
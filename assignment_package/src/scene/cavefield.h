@@ -0,0 +1,46 @@
+#pragma once
+#include "glm_includes.h"
+#include <array>
+#include <cstdint>
+
+// The underground density of one 16 x 256 x 16 Chunk, used to carve caves.
+// perlinNoise3D is far too expensive to evaluate for every voxel, so we only
+// sample it on a coarse lattice with one point every CELL blocks and
+// trilinearly upsample the lattice one 16 x 16 layer at a time.
+// Negative density is open cave, positive density is solid rock.
+class CaveField {
+public:
+    // Spacing of the lattice, in blocks. Must divide 16 and TOP.
+    static constexpr int CELL = 4;
+    // The highest y that can hold a cave
+    static constexpr int TOP = 128;
+    static constexpr int POINTS_XZ = 16 / CELL + 1;
+    static constexpr int POINTS_Y = TOP / CELL + 1;
+
+    // Samples the lattice of the Chunk whose lower-left corner is chunkPos.
+    // Safe to call from any thread.
+    CaveField(glm::ivec2 chunkPos);
+
+    // Writes the density of all 256 columns at height y (0 to TOP) into
+    // out, x-major like ZoneMap: out[x + 16 * z]
+    void layer(int y, float *out) const;
+
+    // Whether a voxel with this density is open cave
+    static bool isCave(float density);
+
+private:
+    // Lattice values upsampled along x and z, so only the y axis is
+    // left to interpolate per layer: m_planes[ly][x + 16 * z]
+    std::array<std::array<float, 256>, POINTS_Y> m_planes;
+};
+
+// Running totals of the time Chunk::GenerateChunkAt spends carving caves,
+// so we can see whether it fits within the generation budget
+struct CaveStats {
+    uint64_t chunks;
+    uint64_t nanoseconds;
+};
+
+// Safe to call from any thread
+void recordCaveTime(uint64_t nanoseconds);
+CaveStats caveStats();
@@ -1,26 +1,56 @@
 #include "chunk.h"
-float WorleyNoise(glm::vec2 uv);
-float surflet3D(glm::vec3 p, glm::vec3 gridPoint);
-float perlinNoise3D(glm::vec3 p);
-float LERP(float x,float y, float fract);
-float interpNoise2D(float x, float y);
-float fbm(float x, float y);
-float mountain(glm::vec2 pos);
-float interpolate(glm::vec2 uv);
-float grass(glm::vec2 pos);
-float Moisture(float worldx,float worldz);
-
-enum BiomeType { Grass,Mountain,Snowland,Desert };
-
-Chunk::Chunk(OpenGLContext* context) : Drawable(context), m_blocks(), m_neighbors{{XPOS, nullptr}, {XNEG, nullptr}, {ZPOS, nullptr}, {ZNEG, nullptr}},
-    m_position(glm::ivec2(0,0)), m_chunkVBOData(this), hasVBOdata(false)
+#include "cavefield.h"
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+// One section of each type, shared by every Chunk wherever a section is
+// uniform. Never written to, since no Chunk owns them.
+static const std::shared_ptr<PalettedBlocks>& uniformSection(BlockType t) {
+    static const std::array<std::shared_ptr<PalettedBlocks>, BLOCK_TYPE_COUNT> sections = []() {
+        std::array<std::shared_ptr<PalettedBlocks>, BLOCK_TYPE_COUNT> s;
+        for(int i = 0; i < BLOCK_TYPE_COUNT; i++) {
+            s[i] = std::make_shared<PalettedBlocks>(4096, static_cast<BlockType>(i));
+        }
+        return s;
+    }();
+    return sections[t];
+}
+
+Chunk::Chunk(OpenGLContext* context) : Drawable(context),
+    m_sections(), m_ownsSection(), m_masks(), m_ownsMasks(false), m_neighbors{nullptr, nullptr, nullptr, nullptr}, m_version(0),
+    m_topNonAir(), m_topSolid(),
+    m_position(glm::ivec2(0,0)), m_chunkVBOData(this), hasVBOdata(false), m_vboBytes(0),
+    m_vboFormat(VertexFormat::Float), hasBlockData(false), m_editedBytes(0)
 {
-    std::fill_n(m_blocks.begin(), 65536, EMPTY);
+    m_sections.fill(uniformSection(EMPTY));
+    m_topNonAir.fill(-1);
+    m_topSolid.fill(-1);
+}
+
+PalettedBlocks& Chunk::writableSection(int s) {
+    if(!m_ownsSection[s]) {
+        m_sections[s] = std::make_shared<PalettedBlocks>(*m_sections[s]);
+        m_ownsSection[s] = true;
+    }
+    return *m_sections[s];
+}
+
+// The index of block (x, y % 16, z) within its section
+static int sectionIndex(int x, int y, int z) {
+    return BlockLayout::index(x, y & 15, z);
+}
+
+static void checkBounds(unsigned int x, unsigned int y, unsigned int z) {
+    if(x > 15 || y > 255 || z > 15) {
+        throw std::out_of_range("Chunk block coordinates out of range");
+    }
 }
 
-// Does bounds checking with at()
 BlockType Chunk::getBlockAt(unsigned int x, unsigned int y, unsigned int z) const {
-    return m_blocks.at(x + 16 * y + 16 * 256 * z);
+    checkBounds(x, y, z);
+    return m_sections[y >> 4]->get(sectionIndex(x, y, z));
 }
 
 // Exists to get rid of compiler warnings about int -> unsigned int implicit conversion
@@ -28,26 +58,386 @@ BlockType Chunk::getBlockAt(int x, int y, int z) const {
     return getBlockAt(static_cast<unsigned int>(x), static_cast<unsigned int>(y), static_cast<unsigned int>(z));
 }
 
-// Does bounds checking with at()
 void Chunk::setBlockAt(unsigned int x, unsigned int y, unsigned int z, BlockType t) {
-    m_blocks.at(x + 16 * y + 16 * 256 * z) = t;
+    checkBounds(x, y, z);
+    writableSection(y >> 4).set(sectionIndex(x, y, z), t);
+    noteColumnWrite(x, z, y, y + 1, t, false);
+    m_version++;
+}
+
+// Checks the bounds of the whole span once, then calls
+// fn(section, index of the span's lowest block in it, stride, block count)
+// for each section the span passes through, bottom to top. The rest of
+// the span is every stride-th block after that index. Layouts without a
+// constant stride along y get one call per block instead.
+template <typename Fn>
+static void forColumnSpan(int x, int z, int yMin, int yMax, Fn fn) {
+    if(x < 0 || x > 15 || z < 0 || z > 15 || yMin < 0 || yMax > 256) {
+        throw std::out_of_range("Chunk column span out of range");
+    }
+    if constexpr(BlockLayout::Y_STRIDE > 0) {
+        for(int y = yMin; y < yMax; y = (y & ~15) + 16) {
+            fn(y >> 4, sectionIndex(x, y, z), BlockLayout::Y_STRIDE, std::min(yMax, (y & ~15) + 16) - y);
+        }
+    } else {
+        for(int y = yMin; y < yMax; y++) {
+            fn(y >> 4, sectionIndex(x, y, z), 1, 1);
+        }
+    }
+}
+
+void Chunk::fillColumn(int x, int z, int yMin, int yMax, BlockType t) {
+    forColumnSpan(x, z, yMin, yMax, [&](int section, int start, int stride, int count) {
+        const PalettedBlocks &blocks = *m_sections[section];
+        if(!blocks.isUniform() || blocks.uniformType() != t) {
+            writableSection(section).fill(start, stride, count, t);
+        }
+    });
+    noteColumnWrite(x, z, yMin, yMax, t, false);
+    m_version++;
+}
+
+void Chunk::fillColumnIfEmpty(int x, int z, int yMin, int yMax, BlockType t) {
+    forColumnSpan(x, z, yMin, yMax, [&](int section, int start, int stride, int count) {
+        const PalettedBlocks &blocks = *m_sections[section];
+        if(!blocks.isUniform() || blocks.uniformType() == EMPTY) {
+            writableSection(section).replace(start, stride, count, EMPTY, t);
+        }
+    });
+    noteColumnWrite(x, z, yMin, yMax, t, true);
+    m_version++;
+}
+
+
+void Chunk::applyBlockWrites(const std::vector<BlockWrite> &writes) {
+    for(const BlockWrite &w : writes) {
+        checkBounds(w.x, w.y, w.z);
+        int i = sectionIndex(w.x, w.y, w.z);
+        if(m_sections[w.y >> 4]->get(i) == w.replaces) {
+            writableSection(w.y >> 4).set(i, w.type);
+            noteColumnWrite(w.x, w.z, w.y, w.y + 1, w.type, false);
+        }
+    }
+    m_version++;
+}
+
+void Chunk::compactBlocks() {
+    for(int s = 0; s < SECTION_COUNT; s++) {
+        if(m_ownsSection[s]) {
+            m_sections[s]->compact();
+            // Uniform sections give their memory back
+            if(m_sections[s]->isUniform()) {
+                m_sections[s] = uniformSection(m_sections[s]->uniformType());
+                m_ownsSection[s] = false;
+            }
+        }
+    }
+}
+
+void Chunk::decodeBlocks(BlockType *out) const {
+    for(int s = 0; s < SECTION_COUNT; s++) {
+        m_sections[s]->decode(out + 4096 * s);
+    }
+}
+
+size_t Chunk::blockBytes() const {
+    // The shared uniform sections cost nothing per Chunk
+    size_t bytes = 0;
+    for(const std::shared_ptr<PalettedBlocks> &section : m_sections) {
+        if(section != uniformSection(section->uniformType())) {
+            bytes += sizeof(PalettedBlocks) + section->bytes();
+        }
+    }
+    if(m_masks) {
+        bytes += sizeof(BlockMasks);
+    }
+    return bytes;
+}
+
+// Where blocks yMin to yMax - 1 were written, of which the ones matching
+// the kind of height (not EMPTY, or colliding) if isSet, the new top
+static void noteHeight(int16_t &top, int yMin, int yMax, bool isSet, bool exact) {
+    if(top == -2) {
+        return;
+    }
+    if(isSet && yMax - 1 > top) {
+        // If only some of the blocks were written, the topmost may
+        // have been skipped, and whatever it holds might not count
+        top = exact ? yMax - 1 : -2;
+    } else if(!isSet && yMin <= top && top < yMax) {
+        top = -2;
+    }
+}
+
+void Chunk::noteColumnWrite(int x, int z, int yMin, int yMax, BlockType t, bool ifEmpty) {
+    static_assert(UNKNOWN_HEIGHT == -2, "noteHeight hardcodes UNKNOWN_HEIGHT");
+    const int column = x + 16 * z;
+    // An empty span writes nothing, and writing only over EMPTY
+    // blocks never removes anything
+    if(yMin >= yMax || (ifEmpty && t == EMPTY)) {
+        return;
+    }
+    if(m_masks) {
+        if(!m_ownsMasks) {
+            m_masks = std::make_shared<BlockMasks>(*m_masks);
+            m_ownsMasks = true;
+        }
+        m_masks->fill(x, z, yMin, yMax, t, ifEmpty);
+    }
+    // Any block not written to was not EMPTY, so the highest one
+    // not EMPTY is always known, but not whether it collides
+    noteHeight(m_topNonAir[column], yMin, yMax, t != EMPTY, true);
+    // and EMPTY blocks never collide either
+    if(!ifEmpty || blockInfo(t).collides) {
+        noteHeight(m_topSolid[column], yMin, yMax, blockInfo(t).collides, !ifEmpty);
+    }
+}
+
+void Chunk::rescanColumn(int column) const {
+    const int x = column & 15, z = column >> 4;
+    m_topNonAir[column] = -1;
+    m_topSolid[column] = -1;
+    for(int s = SECTION_COUNT - 1; s >= 0 && m_topSolid[column] < 0; s--) {
+        const PalettedBlocks &section = *m_sections[s];
+        if(section.isUniform() && section.uniformType() == EMPTY) {
+            continue;
+        }
+        for(int y = 15; y >= 0; y--) {
+            const BlockType t = section.get(sectionIndex(x, y, z));
+            if(t != EMPTY && m_topNonAir[column] < 0) {
+                m_topNonAir[column] = 16 * s + y;
+            }
+            if(blockInfo(t).collides) {
+                m_topSolid[column] = 16 * s + y;
+                break;
+            }
+        }
+    }
 }
 
+int Chunk::topNonAir(int x, int z) const {
+    const int column = x + 16 * z;
+    if(m_topNonAir[column] == UNKNOWN_HEIGHT) {
+        rescanColumn(column);
+    }
+    return m_topNonAir[column];
+}
+
+int Chunk::topSolid(int x, int z) const {
+    const int column = x + 16 * z;
+    if(m_topSolid[column] == UNKNOWN_HEIGHT) {
+        rescanColumn(column);
+    }
+    return m_topSolid[column];
+}
+
+void Chunk::updateHeights() const {
+    for(int column = 0; column < 256; column++) {
+        if(m_topNonAir[column] == UNKNOWN_HEIGHT || m_topSolid[column] == UNKNOWN_HEIGHT) {
+            rescanColumn(column);
+        }
+    }
+}
+
+void Chunk::updateMasks() {
+    if(!m_masks) {
+        m_masks = std::make_shared<BlockMasks>();
+        m_masks->build(m_sections);
+        m_ownsMasks = true;
+    }
+}
+
+bool Chunk::hasBlockAt(int x, int y, int z) const {
+    if(m_masks) {
+        checkBounds(x, y, z);
+        return m_masks->has(x, y, z);
+    }
+    return getBlockAt(x, y, z) != EMPTY;
+}
 
-const static std::unordered_map<Direction, Direction, EnumHash> oppositeDirection {
-    {XPOS, XNEG},
-    {XNEG, XPOS},
-    {YPOS, YNEG},
-    {YNEG, YPOS},
-    {ZPOS, ZNEG},
-    {ZNEG, ZPOS}
-};
+// Opposite directions only differ in their lowest bit
+static Direction oppositeDirection(Direction d) {
+    return static_cast<Direction>(d ^ 1);
+}
+
+
+void Chunk::linkNeighbor(Chunk *neighbor, Direction dir) {
+    if(neighbor != nullptr && this->m_neighbors[neighborIndex(dir)] != neighbor) {
+        this->m_neighbors[neighborIndex(dir)] = neighbor;
+        neighbor->m_neighbors[neighborIndex(oppositeDirection(dir))] = this;
+        // Our shared border now shows in both meshes
+        m_version++;
+        neighbor->m_version++;
+    }
+}
 
+void Chunk::unlinkNeighbors() {
+    for(Direction dir : {XPOS, XNEG, ZPOS, ZNEG}) {
+        Chunk *&neighbor = m_neighbors[neighborIndex(dir)];
+        if(neighbor != nullptr) {
+            neighbor->m_neighbors[neighborIndex(oppositeDirection(dir))] = nullptr;
+            neighbor->m_version++;
+            neighbor = nullptr;
+        }
+    }
+    m_version++;
+}
 
-void Chunk::linkNeighbor(uPtr<Chunk> &neighbor, Direction dir) {
-    if(neighbor != nullptr) {
-        this->m_neighbors[dir] = neighbor.get();
-        neighbor->m_neighbors[oppositeDirection.at(dir)] = this;
+// Only read and written on the main thread, which takes the snapshots
+static MeshingMode s_meshingMode = MeshingMode::Naive;
+
+void Chunk::setMeshingMode(MeshingMode mode) {
+    s_meshingMode = mode;
+}
+
+MeshingMode Chunk::meshingMode() {
+    return s_meshingMode;
+}
+
+// Like s_meshingMode
+static VertexFormat s_vertexFormat = VertexFormat::Packed;
+
+void Chunk::setVertexFormat(VertexFormat format) {
+    s_vertexFormat = format;
+}
+
+VertexFormat Chunk::vertexFormat() {
+    return s_vertexFormat;
+}
+
+ChunkSnapshot Chunk::snapshot() {
+    ChunkSnapshot snapshot;
+    snapshot.version = m_version;
+    snapshot.meshing = s_meshingMode;
+    snapshot.format = s_vertexFormat;
+    updateHeights();
+    updateMasks();
+    snapshot.topNonAir = m_topNonAir;
+    for(int s = 0; s < SECTION_COUNT; s++) {
+        snapshot.sections[s] = m_sections[s];
+        m_ownsSection[s] = false;
+    }
+    snapshot.masks = m_masks;
+    m_ownsMasks = false;
+    for(int n = 0; n < 4; n++) {
+        if(Chunk *neighbor = m_neighbors[n]) {
+            for(int s = 0; s < SECTION_COUNT; s++) {
+                snapshot.neighbors[n][s] = neighbor->m_sections[s];
+                neighbor->m_ownsSection[s] = false;
+            }
+            neighbor->updateMasks();
+            snapshot.neighborMasks[n] = neighbor->m_masks;
+            neighbor->m_ownsMasks = false;
+        }
+    }
+    return snapshot;
+}
+
+// The index of the lowest set bit of v, which must not be 0
+static int ctz64(uint64_t v) {
+#if defined(__GNUC__)
+    return __builtin_ctzll(v);
+#else
+    int n = 0;
+    while(!(v & 1)) {
+        v >>= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+void BlockMasks::build(const std::array<std::shared_ptr<PalettedBlocks>, 16> &sections) {
+    for(int c = 0; c < 256; c++) {
+        present[c].fill(0);
+        opaque[c].fill(0);
+    }
+    std::array<BlockType, 4096> blocks;
+    for(int s = 0; s < Chunk::SECTION_COUNT; s++) {
+        const PalettedBlocks &section = *sections[s];
+        // Each section is 16 bits of a word
+        const int w = s >> 2, shift = 16 * (s & 3);
+        if(section.isUniform()) {
+            const BlockType t = section.uniformType();
+            const uint64_t bits = uint64_t(0xffff) << shift;
+            for(int c = 0; c < 256; c++) {
+                present[c][w] |= t != EMPTY ? bits : 0;
+                opaque[c][w] |= blockInfo(t).opaque ? bits : 0;
+            }
+            continue;
+        }
+        section.decode(blocks.data());
+        for(int x = 0; x < 16; x++) {
+            for(int z = 0; z < 16; z++) {
+                uint64_t p = 0, o = 0;
+                for(int y = 0; y < 16; y++) {
+                    const BlockType t = blocks[BlockLayout::index(x, y, z)];
+                    p |= uint64_t(t != EMPTY) << y;
+                    o |= uint64_t(blockInfo(t).opaque) << y;
+                }
+                present[x + 16 * z][w] |= p << shift;
+                opaque[x + 16 * z][w] |= o << shift;
+            }
+        }
+    }
+}
+
+void BlockMasks::fill(int x, int z, int yMin, int yMax, BlockType t, bool ifEmpty) {
+    Column &p = present[x + 16 * z];
+    Column &o = opaque[x + 16 * z];
+    for(int w = yMin >> 6; w <= (yMax - 1) >> 6; w++) {
+        const int lo = std::max(yMin - 64 * w, 0);
+        const int count = std::min(yMax - 64 * w, 64) - lo;
+        uint64_t span = (count == 64 ? ~0ull : (1ull << count) - 1) << lo;
+        if(ifEmpty) {
+            span &= ~p[w];
+        }
+        p[w] = t != EMPTY ? p[w] | span : p[w] & ~span;
+        o[w] = blockInfo(t).opaque ? o[w] | span : o[w] & ~span;
+    }
+}
+
+void OccupancyMasks::build(const ChunkSnapshot &snapshot) {
+    for(int x = 0; x < 16; x++) {
+        for(int z = 0; z < 16; z++) {
+            present[index(x, z)] = snapshot.masks->present[x + 16 * z];
+            opaque[index(x, z)] = snapshot.masks->opaque[x + 16 * z];
+        }
+    }
+    // The border, which stays EMPTY where there is no neighbor
+    auto border = [&](int to, const std::shared_ptr<const BlockMasks> &from, int column) {
+        present[to] = from ? from->present[column] : Column{};
+        opaque[to] = from ? from->opaque[column] : Column{};
+    };
+    for(int i = 0; i < 16; i++) {
+        border(index(16, i), snapshot.neighborMasks[0], 0 + 16 * i);
+        border(index(-1, i), snapshot.neighborMasks[1], 15 + 16 * i);
+        border(index(i, 16), snapshot.neighborMasks[2], i);
+        border(index(i, -1), snapshot.neighborMasks[3], i + 16 * 15);
+    }
+}
+
+// The blocks of p (opaque where o) with a visible face towards the
+// blocks of np (opaque where no)
+static uint64_t visibleFaces(uint64_t p, uint64_t o, uint64_t np, uint64_t no) {
+    return p & ~no & (o | ~np);
+}
+
+void OccupancyMasks::faces(int x, int z, std::array<Column, 6> &out) const {
+    const Column &c = present[index(x, z)];
+    const Column &co = opaque[index(x, z)];
+    const int sides[4][2] = {{XPOS, index(x + 1, z)}, {XNEG, index(x - 1, z)},
+                             {ZPOS, index(x, z + 1)}, {ZNEG, index(x, z - 1)}};
+    for(int w = 0; w < WORDS; w++) {
+        for(const auto &side : sides) {
+            out[side[0]][w] = visibleFaces(c[w], co[w], present[side[1]][w], opaque[side[1]][w]);
+        }
+        // Bit y of above is block y + 1, and of below block y - 1.
+        // Above the world and below it is EMPTY.
+        auto above = [&](const Column &m) { return (m[w] >> 1) | (w + 1 < WORDS ? m[w + 1] << 63 : 0); };
+        auto below = [&](const Column &m) { return (m[w] << 1) | (w > 0 ? m[w - 1] >> 63 : 0); };
+        out[YPOS][w] = visibleFaces(c[w], co[w], above(c), above(co));
+        out[YNEG][w] = visibleFaces(c[w], co[w], below(c), below(co));
     }
 }
 
@@ -66,7 +456,155 @@ Neighbor back = {ZPOS, glm::ivec3(0, 0, 1), {glm::ivec3(0, 0, 1),glm::ivec3(1, 0
 
 const static std::array<Neighbor, 6> neighbors = {right, left, top, bot, back, front};
 
-const static std::unordered_map<int, glm::vec4> mv_vertex = {{0, glm::vec4(0, 0, 0, 0)}, {1, glm::vec4(1.f / 16.f, 0, 0, 0)}, {2, glm::vec4(1.f / 16.f, 1.f / 16.f, 0, 0)}, {3, glm::vec4(0, 1.f / 16.f, 0, 0)}};
+// The UV offset of each corner of a face from its tile's lower-left corner
+const static std::array<glm::vec4, 4> mv_vertex = {glm::vec4(0, 0, 0, 0), glm::vec4(1.f / 16.f, 0, 0, 0), glm::vec4(1.f / 16.f, 1.f / 16.f, 0, 0), glm::vec4(0, 1.f / 16.f, 0, 0)};
+
+// The same corners in tiles
+const static std::array<glm::ivec2, 4> tileCorners = {glm::ivec2(0, 0), glm::ivec2(1, 0), glm::ivec2(1, 1), glm::ivec2(0, 1)};
+
+// VertexFormat::Packed. The first word holds the geometry:
+//   bits 0-4   x, 0 to 16
+//   bits 5-13  y, 0 to 256
+//   bits 14-18 z, 0 to 16
+//   bits 19-21 the Direction the face points in
+// and the second the texture:
+//   bits 0-7   the tile's index in the 16 x 16 atlas, column + 16 * row
+//   bits 8-12  u, in tiles from the tile's corner, 0 to 16
+//   bits 13-21 v, likewise, 0 to 256
+//   bit 22     whether the texture scrolls
+//   bit 23     whether the tile repeats across the face (greedy quads)
+//   bits 24-31 alpha, 0 to 255
+// Greedy quads only span more than one tile along y in v, never in u.
+static glm::uvec2 packVertex(glm::ivec3 position, Direction d, int tile, glm::ivec2 uv,
+                             bool animated, bool tiled, float alpha) {
+    const uint32_t geometry = uint32_t(position.x) | uint32_t(position.y) << 5
+        | uint32_t(position.z) << 14 | uint32_t(d) << 19;
+    const uint32_t texture = uint32_t(tile) | uint32_t(uv.x) << 8 | uint32_t(uv.y) << 13
+        | uint32_t(animated) << 22 | uint32_t(tiled) << 23 | uint32_t(std::lround(alpha * 255.f)) << 24;
+    return glm::uvec2(geometry, texture);
+}
+
+// The axis (0 for x, 1 for y, 2 for z) a unit vector points along
+static int axisOf(glm::ivec3 unit) {
+    return unit.x != 0 ? 0 : (unit.y != 0 ? 1 : 2);
+}
+
+// MeshingMode::Greedy. The visible faces of each direction are scattered
+// into a 16 x height x 16 volume of BlockTypes, then each slice of it
+// across the direction is covered with rectangles: as wide as the same
+// type runs along the face's U axis, then grown along V while whole rows
+// match. A face's U and V axes are the directions its corners go from
+// vertPos[0], so merged quads keep the naive mesher's corner order.
+//
+// Each vertex's UV counts tiles from the quad's corner, and its normal's
+// w is 2 plus the index of the block's tile in the 16 x 16 atlas, which
+// lambert.frag.glsl uses to repeat the tile across the quad.
+static void meshGreedy(const ChunkSnapshot &snapshot, const PaddedBlockView &view, const OccupancyMasks &masks,
+                       int top, ChunkVBOData &out, int &opaqueQuads, int &transparentQuads) {
+    if(top < 0) {
+        return;
+    }
+    const BlockType *blocks = view.blocks.data();
+    std::vector<std::array<OccupancyMasks::Column, 6>> columns(256);
+    for(int x = 0; x < 16; x++) {
+        for(int z = 0; z < 16; z++) {
+            if(snapshot.topNonAir[x + 16 * z] >= 0) {
+                masks.faces(x, z, columns[x + 16 * z]);
+            }
+        }
+    }
+
+    const int height = top + 1;
+    const int dims[3] = {16, height, 16};
+    const int strides[3] = {1, 256, 16};
+    std::vector<BlockType> volume(256 * height);
+    std::vector<int> sliceFaces(256);
+    for(const Neighbor &neigh : neighbors) {
+        const Direction d = neigh.direction;
+        const int n = axisOf(neigh.vecDirection);
+        const glm::ivec3 u = neigh.vertPos[1] - neigh.vertPos[0];
+        const glm::ivec3 v = neigh.vertPos[3] - neigh.vertPos[0];
+        const int ua = axisOf(u), va = axisOf(v);
+
+        std::fill(volume.begin(), volume.end(), EMPTY);
+        std::fill(sliceFaces.begin(), sliceFaces.end(), 0);
+        for(int x = 0; x < 16; x++) {
+            for(int z = 0; z < 16; z++) {
+                const int columnTop = snapshot.topNonAir[x + 16 * z];
+                for(int w = 0; w <= columnTop / 64; w++) {
+                    for(uint64_t bits = columns[x + 16 * z][d][w]; bits != 0; bits &= bits - 1) {
+                        const int y = 64 * w + ctz64(bits);
+                        volume[x + 16 * z + 256 * y] = blocks[PaddedBlockView::index(x, y, z)];
+                        sliceFaces[n == 0 ? x : (n == 1 ? y : z)]++;
+                    }
+                }
+            }
+        }
+
+        const glm::vec4 normalXYZ(neigh.vecDirection, 0);
+        for(int slice = 0; slice < dims[n]; slice++) {
+            if(sliceFaces[slice] == 0) {
+                continue;
+            }
+            BlockType *plane = volume.data() + slice * strides[n];
+            const int su = strides[ua], sv = strides[va];
+            for(int b = 0; b < dims[va]; b++) {
+                for(int a = 0; a < dims[ua]; a++) {
+                    BlockType *first = plane + a * su + b * sv;
+                    const BlockType t = *first;
+                    if(t == EMPTY) {
+                        continue;
+                    }
+                    int width = 1;
+                    while(a + width < dims[ua] && first[width * su] == t) {
+                        width++;
+                    }
+                    int rows = 1;
+                    for(; b + rows < dims[va]; rows++) {
+                        bool match = true;
+                        for(int i = 0; i < width && match; i++) {
+                            match = first[i * su + rows * sv] == t;
+                        }
+                        if(!match) {
+                            break;
+                        }
+                    }
+                    for(int j = 0; j < rows; j++) {
+                        for(int i = 0; i < width; i++) {
+                            first[i * su + j * sv] = EMPTY;
+                        }
+                    }
+
+                    // The block at corner 0, from which U and V span the quad
+                    glm::ivec3 origin;
+                    origin[n] = slice;
+                    origin[ua] = u[ua] > 0 ? a : a + width - 1;
+                    origin[va] = v[va] > 0 ? b : b + rows - 1;
+                    const BlockInfo &info = blockInfo(t);
+                    const unsigned char *tile = info.faceTiles[d];
+                    const int tileIndex = tile[0] + 16 * tile[1];
+                    const glm::vec4 normal = normalXYZ + glm::vec4(0, 0, 0, 2 + tileIndex);
+                    std::vector<glm::vec4> &interleaved = info.transparent ? out.m_trans : out.m_op;
+                    std::vector<glm::uvec2> &packed = info.transparent ? out.m_transPacked : out.m_opPacked;
+                    for(int i = 0; i < 4; i++) {
+                        const glm::ivec2 corner = tileCorners[i];
+                        const glm::ivec3 position = origin + neigh.vertPos[i]
+                            + corner.x * (width - 1) * u + corner.y * (rows - 1) * v;
+                        const glm::ivec2 uv = corner * glm::ivec2(width, rows);
+                        if(snapshot.format == VertexFormat::Packed) {
+                            packed.push_back(packVertex(position, d, tileIndex, uv, info.animated, true, info.alpha));
+                            continue;
+                        }
+                        interleaved.push_back(glm::vec4(position, 1));
+                        interleaved.push_back(normal);
+                        interleaved.push_back(glm::vec4(uv, info.animated ? 0.f : 1.f, info.alpha));
+                    }
+                    (info.transparent ? transparentQuads : opaqueQuads)++;
+                }
+            }
+        }
+    }
+}
 
 
 void Chunk::destroyVBOdata() {
@@ -75,100 +613,86 @@ void Chunk::destroyVBOdata() {
 }
 
 void Chunk::createVBOdata() {
+    createVBOdata(snapshot(), m_chunkVBOData);
+    m_trans = m_chunkVBOData.m_transIdx.size();
+    m_opq = m_chunkVBOData.m_opIdx.size();
+}
+
+void Chunk::createVBOdata(const ChunkSnapshot &snapshot, ChunkVBOData &out) {
 
     // create opaque data
-    std::vector<glm::vec4> interleavedData_opaque;
+    out.m_op.clear();
+    out.m_opPacked.clear();
     std::vector<GLuint> idx_opaque;
     int m_quatOpaqueCount = 0;
 
     // create transparent data
-    std::vector<glm::vec4> interleavedData_transparent;
+    out.m_trans.clear();
+    out.m_transPacked.clear();
     std::vector<GLuint> idx_transparent;
     int m_quatTransparentCount = 0;
 
-    for(int x = 0; x < 16; x++) {
-        for(int z = 0; z < 16; z++) {
-            for(int y = 0; y < 256; y++) {
-                BlockType t = getBlockAt(x, y, z);
-                if (t != EMPTY) {
-                    for (auto & neigh : neighbors) {
-                        glm::ivec3 neighborPos = glm::ivec3(x + neigh.vecDirection.x, y + neigh.vecDirection.y, z + neigh.vecDirection.z);
-                        BlockType neighborType = getNeighborBlock(neighborPos.x, neighborPos.y, neighborPos.z);
-                        if (neighborType == EMPTY) {
-                            Direction direction = neigh.direction;
-                            glm::vec4 uv = m_uvs.at(t).at(direction);
-                            for (int i = 0; i < 4; i++) {
-                                glm::vec4 vertexUV = uv + mv_vertex.at(i);
-                                glm::vec4 position = glm::vec4(neigh.vertPos[i].x + x, neigh.vertPos[i].y + y, neigh.vertPos[i].z + z, 1);
-                                glm::vec4 normal = glm::vec4(neigh.vecDirection, 1);
-                              // std::cout << "break" << std::endl;
-                                switch(t) {
-                                case GRASS:
-                                    interleavedData_opaque.push_back(position);
-                                    interleavedData_opaque.push_back(normal);
-                                    vertexUV.z = 1;
-                                    vertexUV.w = 1;
-                                    interleavedData_opaque.push_back(vertexUV);
-                                    break;
-                                case DIRT:
-                                    interleavedData_opaque.push_back(position);
-                                    interleavedData_opaque.push_back(normal);
-                                    vertexUV.z = 1;
-                                    vertexUV.w = 1;
-                                    interleavedData_opaque.push_back(vertexUV);
-                                    break;
-                                case STONE:
-                                    interleavedData_opaque.push_back(position);
-                                    interleavedData_opaque.push_back(normal);
-                                    vertexUV.z = 1;
-                                    vertexUV.w = 1;
-                                    interleavedData_opaque.push_back(vertexUV);
-                                    break;
-                                case WATER:
-                                    if (neighborType == EMPTY) {
-                                        interleavedData_transparent.push_back(position);
-                                        interleavedData_transparent.push_back(normal);
-                                        vertexUV.z = 0;
-                                        vertexUV.w = 0.8;
-                                        interleavedData_transparent.push_back(vertexUV);
-                                    } else {
-                                        continue;
+    // Unpack all of our blocks and our neighbors' borders up front, then
+    // find the faces of a whole column at a time from its occupancy
+    PaddedBlockView view;
+    snapshot.fillPaddedView(view);
+    const BlockType *blocks = view.blocks.data();
+    // Nothing above the highest block can have a face
+    const int top = *std::max_element(snapshot.topNonAir.begin(), snapshot.topNonAir.end());
+    OccupancyMasks masks;
+    masks.build(snapshot);
+    std::array<OccupancyMasks::Column, 6> faces;
+
+    if(snapshot.meshing == MeshingMode::Greedy) {
+        meshGreedy(snapshot, view, masks, top, out, m_quatOpaqueCount, m_quatTransparentCount);
+    } else {
+        for(int x = 0; x < 16; x++) {
+            for(int z = 0; z < 16; z++) {
+                const int columnTop = snapshot.topNonAir[x + 16 * z];
+                if(columnTop < 0) {
+                    continue;
+                }
+                masks.faces(x, z, faces);
+                for(int w = 0; w <= columnTop / 64; w++) {
+                    uint64_t any = faces[0][w] | faces[1][w] | faces[2][w] | faces[3][w] | faces[4][w] | faces[5][w];
+                    // Lowest y first, like a block by block walk
+                    while(any != 0) {
+                        const int bit = ctz64(any);
+                        any &= any - 1;
+                        const int y = 64 * w + bit;
+                        BlockType t = blocks[PaddedBlockView::index(x, y, z)];
+                        const BlockInfo &info = blockInfo(t);
+                        std::vector<glm::vec4> &interleaved = info.transparent ? out.m_trans : out.m_op;
+                        std::vector<glm::uvec2> &packed = info.transparent ? out.m_transPacked : out.m_opPacked;
+                        for (size_t n = 0; n < neighbors.size(); n++) {
+                            const Neighbor &neigh = neighbors[n];
+                            if ((faces[neigh.direction][w] >> bit) & 1) {
+                                if (snapshot.format == VertexFormat::Packed) {
+                                    const unsigned char *tile = info.faceTiles[neigh.direction];
+                                    for (int i = 0; i < 4; i++) {
+                                        packed.push_back(packVertex(neigh.vertPos[i] + glm::ivec3(x, y, z), neigh.direction,
+                                                                    tile[0] + 16 * tile[1], tileCorners[i],
+                                                                    info.animated, false, info.alpha));
+                                    }
+                                } else {
+                                    // The shader scrolls the texture of faces whose UV z is 0,
+                                    // and uses UV w as their alpha
+                                    glm::vec4 uv = glm::vec4(faceUV(t, neigh.direction), info.animated ? 0.f : 1.f, info.alpha);
+                                    glm::vec4 normal = glm::vec4(neigh.vecDirection, 1);
+                                    for (int i = 0; i < 4; i++) {
+                                        glm::vec4 position = glm::vec4(neigh.vertPos[i].x + x, neigh.vertPos[i].y + y, neigh.vertPos[i].z + z, 1);
+                                        interleaved.push_back(position);
+                                        interleaved.push_back(normal);
+                                        interleaved.push_back(uv + mv_vertex[i]);
                                     }
-                                    break;
-                                case LAVA:
-                                    interleavedData_opaque.push_back(position);
-                                    interleavedData_opaque.push_back(normal);
-                                    vertexUV.z = 0;
-                                    vertexUV.w = 1;
-                                    interleavedData_opaque.push_back(vertexUV);
-                                    break;
-                                case SAND:
-                                    interleavedData_opaque.push_back(position);
-                                    interleavedData_opaque.push_back(normal);
-                                    vertexUV.z = 1;
-                                    vertexUV.w = 1;
-                                    interleavedData_opaque.push_back(vertexUV);
-                                    break;
-                                case SNOW:
-                                    interleavedData_opaque.push_back(position);
-                                    interleavedData_opaque.push_back(normal);
-                                    vertexUV.z = 1;
-                                    vertexUV.w = 1;
-                                    interleavedData_opaque.push_back(vertexUV);
-                                    break;
-                                default:
-                                    // Other block types are not yet handled, so we default to debug purple
-                                    break;
+                                }
+                                if (info.transparent) {
+                                    m_quatTransparentCount += 1;
+                                } else {
+                                    m_quatOpaqueCount += 1;
                                 }
                             }
                         }
-                        if (t == WATER) {
-                            if (neighborType == EMPTY) {
-                                m_quatTransparentCount += 1;
-                            }
-                        } else {
-                            m_quatOpaqueCount += 1;
-                        }
                     }
                 }
             }
@@ -184,7 +708,6 @@ void Chunk::createVBOdata() {
         idx_transparent.push_back(i * 4 + 3);
 
     }
-    m_trans = idx_transparent.size();
 
     for (int i = 0; i < m_quatOpaqueCount; i++) {
         idx_opaque.push_back(i * 4);
@@ -194,77 +717,131 @@ void Chunk::createVBOdata() {
         idx_opaque.push_back(i * 4 + 2);
         idx_opaque.push_back(i * 4 + 3);
     }
-    m_opq = idx_opaque.size();
 
-    m_chunkVBOData.m_trans = interleavedData_transparent;
-    m_chunkVBOData.m_op = interleavedData_opaque;
-    m_chunkVBOData.m_transIdx = idx_transparent;
-    m_chunkVBOData.m_opIdx = idx_opaque;
+    out.m_version = snapshot.version;
+    out.m_format = snapshot.format;
+    out.m_transIdx = std::move(idx_transparent);
+    out.m_opIdx = std::move(idx_opaque);
    // createVBO(interleavedData_transparent, idx_transparent, interleavedData_opaque, idx_opaque);
 }
 
 //void Chunk::pushVBO()
 
-void Chunk::createVBO(std::vector<glm::vec4> &interleave_trans, std::vector<GLuint> &idx_trans, std::vector<glm::vec4> &interleave_opq, std::vector<GLuint> &idx_opq) {
-    this->m_opq = idx_opq.size();
-    this->m_trans = idx_trans.size();
+void Chunk::createVBO(const ChunkVBOData &data) {
+    this->m_opq = data.m_opIdx.size();
+    this->m_trans = data.m_transIdx.size();
+    m_vboFormat = data.m_format;
+    const bool packed = data.m_format == VertexFormat::Packed;
+    const size_t transBytes = packed ? data.m_transPacked.size() * sizeof(glm::uvec2) : data.m_trans.size() * sizeof(glm::vec4);
+    const size_t opqBytes = packed ? data.m_opPacked.size() * sizeof(glm::uvec2) : data.m_op.size() * sizeof(glm::vec4);
 
     generateIdx_trans();
     bindIdxTrans();
     mp_context->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_bufIdx_trans);
-    mp_context->glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_trans * sizeof(GLuint), idx_trans.data(), GL_STATIC_DRAW);
+    mp_context->glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_trans * sizeof(GLuint), data.m_transIdx.data(), GL_STATIC_DRAW);
     generatedInterleavedTrans();
     bindInterleavedTrans();
     mp_context->glBindBuffer(GL_ARRAY_BUFFER, m_buf_trans);
-    mp_context->glBufferData(GL_ARRAY_BUFFER, interleave_trans.size() * sizeof(glm::vec4), interleave_trans.data(), GL_STATIC_DRAW);
+    mp_context->glBufferData(GL_ARRAY_BUFFER, transBytes,
+                             packed ? (const void*)data.m_transPacked.data() : (const void*)data.m_trans.data(), GL_STATIC_DRAW);
 
     generateIdx_opq();
     bindIdxOpq();
     mp_context->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_bufIdx_opq);
-    mp_context->glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_opq * sizeof(GLuint), idx_opq.data(), GL_STATIC_DRAW);
+    mp_context->glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_opq * sizeof(GLuint), data.m_opIdx.data(), GL_STATIC_DRAW);
     generatedInterleavedOpq();
     bindInterleavedOpq();
     mp_context->glBindBuffer(GL_ARRAY_BUFFER, m_buf_opq);
-    mp_context->glBufferData(GL_ARRAY_BUFFER, interleave_opq.size() * sizeof(glm::vec4), interleave_opq.data(), GL_STATIC_DRAW);
+    mp_context->glBufferData(GL_ARRAY_BUFFER, opqBytes,
+                             packed ? (const void*)data.m_opPacked.data() : (const void*)data.m_op.data(), GL_STATIC_DRAW);
+
+    m_vboBytes = transBytes + opqBytes + (data.m_transIdx.size() + data.m_opIdx.size()) * sizeof(GLuint);
 }
 
 GLenum Chunk::drawMode() {
     return GL_TRIANGLES;
 }
 
-BlockType Chunk::getNeighborBlock(int x,  int y, int z) {
-    if(x < 0) {
-        if(auto n = m_neighbors[XNEG]) {
-            return n->getBlockAt(15, y, z);
-        }else {
-            return EMPTY;
-        }
+bool Chunk::packedVertices() {
+    return m_vboFormat == VertexFormat::Packed;
+}
+
+// Whether the section is uniform, and not of type t
+static bool uniformOtherThan(const PalettedBlocks &section, BlockType t) {
+    return section.isUniform() && section.uniformType() != t;
+}
+
+// Whether the section is uniform, and hides every face of a block of
+// type t next to it, as OccupancyMasks::faces decides
+static bool uniformHiding(const PalettedBlocks &section, BlockType t) {
+    if(!section.isUniform()) {
+        return false;
     }
-    if(x > 15) {
-        if(auto n = m_neighbors[XPOS]) {
-            return n->getBlockAt(0, y, z);
-        }else {
-            return EMPTY;
-        }
+    const BlockType n = section.uniformType();
+    return blockInfo(n).opaque || (n != EMPTY && !blockInfo(t).opaque);
+}
+
+bool ChunkSnapshot::sectionHasFaces(int s) const {
+    const PalettedBlocks &section = *sections[s];
+    if(!section.isUniform()) {
+        return true;
     }
-    if(z < 0) {
-        if(auto n = m_neighbors[ZNEG]) {
-            return n->getBlockAt(x, y, 15);
-        }else {
-            return EMPTY;
+    if(section.uniformType() == EMPTY) {
+        return false;
+    }
+    // A solid uniform section only shows faces where it touches blocks
+    // that don't hide them. Faces below the world and next to missing
+    // neighbors count as exposed.
+    const BlockType t = section.uniformType();
+    if(s == 0 || s == Chunk::SECTION_COUNT - 1 || !uniformHiding(*sections[s - 1], t)
+            || !uniformHiding(*sections[s + 1], t)) {
+        return true;
+    }
+    for(const Sections &n : neighbors) {
+        if(n[s] == nullptr || !uniformHiding(*n[s], t)) {
+            return true;
         }
     }
-    if(z > 15) {
-        if(auto n = m_neighbors[ZPOS]) {
-            return n->getBlockAt(x, y, 0);
-        }else {
-            return EMPTY;
+    return false;
+}
+
+void ChunkSnapshot::fillPaddedView(PaddedBlockView &view) const {
+    BlockType *out = view.blocks.data();
+    std::array<BlockType, 4096> section;
+    for(int s = 0; s < Chunk::SECTION_COUNT; s++) {
+        sections[s]->decode(section.data());
+        for(int x = 0; x < 16; x++) {
+            for(int z = 0; z < 16; z++) {
+                BlockType *column = out + PaddedBlockView::index(x, 16 * s, z);
+                for(int y = 0; y < 16; y++) {
+                    column[y] = section[BlockLayout::index(x, y, z)];
+                }
+            }
         }
     }
-    if(y < 0 || y > 255) {
-        return EMPTY;
+
+    // The border, which stays EMPTY above, below and where there is no neighbor
+    const Sections &xPos = neighbors[0];
+    const Sections &xNeg = neighbors[1];
+    const Sections &zPos = neighbors[2];
+    const Sections &zNeg = neighbors[3];
+    for(int y = 0; y < 256; y++) {
+        const int s = y >> 4;
+        for(int i = 0; i < 16; i++) {
+            if(xNeg[s]) {
+                out[PaddedBlockView::index(-1, y, i)] = xNeg[s]->get(sectionIndex(15, y, i));
+            }
+            if(xPos[s]) {
+                out[PaddedBlockView::index(16, y, i)] = xPos[s]->get(sectionIndex(0, y, i));
+            }
+            if(zNeg[s]) {
+                out[PaddedBlockView::index(i, y, -1)] = zNeg[s]->get(sectionIndex(i, y, 15));
+            }
+            if(zPos[s]) {
+                out[PaddedBlockView::index(i, y, 16)] = zPos[s]->get(sectionIndex(i, y, 0));
+            }
+        }
     }
-    return getBlockAt(x,y,z);
 }
 
 void Chunk::generateTestTerrain(glm::ivec2 chunkPos) {
@@ -283,215 +860,90 @@ void Chunk::generateTestTerrain(glm::ivec2 chunkPos) {
 
 
 
-void Chunk::GenerateChunkAt(glm::vec2 xz){
+void Chunk::GenerateChunkAt(glm::vec2 xz, const ZoneMap &zoneMap){
+    fillTerrain(glm::ivec2(xz), zoneMap);
+    carveCaves(glm::ivec2(xz), zoneMap);
+}
+
+void Chunk::fillTerrain(glm::ivec2 chunkPos, const ZoneMap &zoneMap) {
 
-//    int x_end = xz.x+16;
-//    int z_end = xz.y+16;
+    // Offset of this Chunk's lower-left corner within its zone
+    glm::ivec2 zoneOffset = chunkPos - zoneMap.zonePos();
 
     for(int x=0;x<16;++x){
         for(int z = 0;z<16;++z){
-            float worldx = x+xz.x;
-            float worldz = z+xz.y;
-
-            float mountainH = mountain(glm::vec2(worldx,worldz));
-            float grassH = grass(glm::vec2(worldx,worldz));
-            float H = LERP(mountainH,grassH,interpolate(glm::vec2(mountainH,grassH)));
-
-            float moisture = Moisture(worldx,worldz);
-//            std::cout<<moisture<<std::endl;
-
-//            BiomeType biome = (H>150) ? Mountain : Grass;
-
-            BiomeType biome = (H>150) ? ((moisture>0.45)? Mountain : Snowland) : ((moisture>0.45)? Grass : Desert);
-
-
-            for (int i = 0;i<H;i++){
-                //set underground
-                if (i<=128 && i>0){
-                    //float p = perlinNoise3D(glm::vec3(abs((x % 64)/64.f),abs((i%32)/32.f),abs((z%64)/64.f)));
-
-                    setBlockAt(x, i, z, STONE);
-
-//                    if (p>=0){
-//                        setBlockAt(x, i, z, STONE);
-//                    }else{
-//                        if (i<25){
-//                            //TODO:replace WATER with LAVA
-//                            setBlockAt(x, i, z, LAVA);
-//                        }else{
-//                            setBlockAt(x, i, z, EMPTY);
-//                        }
-//                    }
-                }
-//                else if (i==0){
-//                    setBlockAt(x, 0, z, BEDROCK);
-//                }
-                else{
-                    //set y>128
-                    switch(biome) {
-                    case Grass:
-                        setBlockAt(x, i, z, DIRT);
-                        break;
-                    case Mountain:
-                        setBlockAt(x, i, z, STONE);
-                        break;
-                    case Snowland:
-                        setBlockAt(x, i, z, STONE);
-                        break;
-                    case Desert:
-                        setBlockAt(x,i,z,SAND);
-                        break;
-                    }
-                    //set water
-                    if (i<139 && getBlockAt(x,i,z) == EMPTY){
-                        setBlockAt(x,i,z,WATER);
-                    }
-                }
-            }
+            float H = zoneMap.heightAt(zoneOffset.x + x, zoneOffset.y + z);
+            BiomeType biome = zoneMap.biomeAt(zoneOffset.x + x, zoneOffset.y + z);
+
+            // Every block below H is filled, and the top
+            // block sits at H truncated to an int
+            int fillTop = static_cast<int>(std::ceil(H));
+            int top = static_cast<int>(H);
+            BlockType layer = STONE;
+            BlockType topBlock = STONE;
             switch(biome) {
             case Grass:
-                setBlockAt(x,H,z,GRASS);
+                layer = DIRT;
+                topBlock = GRASS;
                 break;
             case Mountain:
-                if(H>200){
-                    setBlockAt(x,H,z,SNOW);
-                }else{
-                    setBlockAt(x,H,z,STONE);
-                }
+                topBlock = H > 200 ? SNOW : STONE;
                 break;
             case Snowland:
-                setBlockAt(x, H, z, SNOW);
+                topBlock = SNOW;
                 break;
             case Desert:
-                setBlockAt(x,H,z,SAND);
+                layer = SAND;
+                topBlock = SAND;
                 break;
             }
-        }
-    }
-}
-
 
-float interpolate(glm::vec2 uv){
-    float t= glm::smoothstep(0.27f, 0.42f,WorleyNoise(glm::vec2(abs(uv.x /2560.f),abs(uv.y/2560.f))));
-    return t;
-}
-
-float noise2D(glm::vec2 p ) {
-    return glm::fract(sin(glm::dot(p, glm::vec2(127.1, 311.7))) *
-                 43758.5453);
-}
-float grass(glm::vec2 pos){
-    float h = fbm(cos(pos.x/64.f),cos(pos.y/64.f));
-    h = LERP(0.2,0.7,h*10);
-    return glm::clamp(h*70+111, 0.f, 255.f);
-}
-float mountain(glm::vec2 pos){
-    float h = WorleyNoise(glm::vec2(cos(pos.x/128.f),cos(pos.y/128.f)));
-    h=LERP(50,255,h);
-    return glm::clamp(h, 0.f, 255.f);
-}
-
-
-
-float fbm(float x, float y) {
-    float total = 0;
-    float persistence = 0.25f;
-    int octaves = 8;
-    float freq = 2.f;
-    float amp = 0.5f;
-    for(int i = 1; i <= octaves; i++) {
-        freq *= 2.f;
-        amp *= persistence;
-
-        total += interpNoise2D(x * freq,
-                               y * freq) * amp;
+            fillColumn(x, z, 0, 1, layer);
+            // Caves are carved out of the stone afterwards by carveCaves()
+            fillColumn(x, z, 1, std::min(fillTop, 129), STONE);
+            fillColumn(x, z, 129, fillTop, layer);
+            setBlockAt(x, top, z, topBlock);
+            fillColumnIfEmpty(x, z, top + 1, WATER_LEVEL, WATER);
+        }
     }
-    return total;
 }
-float interpNoise2D(float x, float y) {
-    double intX,intY;
-    float fractX = modf(x,&intX);
-    float fractY = modf(y,&intY);
 
-    float v1 = noise2D(glm::vec2(intX, intY));
-    float v2 = noise2D(glm::vec2(intX+1, intY));
-    float v3 = noise2D(glm::vec2(intX, intY+1));
-    float v4 = noise2D(glm::vec2(intX+1, intY+1));
-
-    float i1 = LERP(v1, v2, fractX);
-    float i2 = LERP(v3, v4, fractX);
-    return LERP(i1, i2, fractY);
-}
-float LERP(float x,float y, float fract){
-    return (1-fract)*x+fract*y;
-}
-
-float Height(float worldx,float worldz){
-    float mountainH = mountain(glm::vec2(worldx,worldz));
-    float grassH = grass(glm::vec2(worldx,worldz));
-    return LERP(mountainH,grassH,interpolate(glm::vec2(mountainH,grassH)));
-}
-
-float Moisture(float worldx,float worldz){
-    return WorleyNoise(glm::vec2(abs(worldx/2056.f),abs(worldz/2056.f)));
-}
-
-glm::vec2 random2( glm::vec2 p ) {
-    return glm::fract(glm::sin(glm::vec2(glm::dot(p, glm::vec2(127.1, 311.7)),
-                 glm::dot(p, glm::vec2(269.5,183.3))))
-                 * 43758.5453f);
-}
-float WorleyNoise(glm::vec2 uv) {
-    uv *= 10.0; // Now the space is 10x10 instead of 1x1. Change this to any number you want.
-    glm::vec2 uvInt = glm::floor(uv);
-    glm::vec2 uvFract = glm::fract(uv);
-    float minDist = 1.0; // Minimum distance initialized to max.
-    for(int y = -1; y <= 1; ++y) {
-        for(int x = -1; x <= 1; ++x) {
-            glm::vec2 neighbor = glm::vec2(float(x), float(y)); // Direction in which neighbor cell lies
-            glm::vec2 point = random2(uvInt + neighbor); // Get the Voronoi centerpoint for the neighboring cell
-            glm::vec2 diff = neighbor + point - uvFract; // Distance between fragment coord and neighbor’s Voronoi point
-            float dist = glm::length(diff);
-            minDist = glm::min(minDist, dist);
+void Chunk::carveCaves(glm::ivec2 chunkPos, const ZoneMap &zoneMap) {
+    auto start = std::chrono::steady_clock::now();
+
+    // Highest y each column may be carved to
+    glm::ivec2 zoneOffset = chunkPos - zoneMap.zonePos();
+    std::array<int, 256> caveCeiling;
+    int top = 0;
+    for(int z = 0; z < 16; z++) {
+        for(int x = 0; x < 16; x++) {
+            int H = static_cast<int>(zoneMap.heightAt(zoneOffset.x + x, zoneOffset.y + z));
+            caveCeiling[x + 16 * z] = std::min(CaveField::TOP, H - CAVE_ROOF);
+            top = std::max(top, caveCeiling[x + 16 * z]);
         }
     }
-    return minDist;
-}
-
-float perlinNoise3D(glm::vec3 p) {
-    float surfletSum = 0.f;
-    // Iterate over the 8 integer corners surrounding uv
-    for(int dx = 0; dx <= 1; ++dx) {
-        for(int dy = 0; dy <= 1; ++dy) {
-            for(int dz = 0; dz <= 1; ++dz) {
-                surfletSum += surflet3D(p, glm::floor(p) + glm::vec3(dx, dy, dz));
+    if(top > 0) {
+        CaveField caves(chunkPos);
+        float density[256];
+        for(int y = 1; y <= top; y++) {
+            // Only stone is carved, so sections without any are skipped
+            if(uniformOtherThan(*m_sections[y >> 4], STONE)) {
+                y |= 15;
+                continue;
+            }
+            caves.layer(y, density);
+            for(int z = 0; z < 16; z++) {
+                for(int x = 0; x < 16; x++) {
+                    if(y <= caveCeiling[x + 16 * z] && CaveField::isCave(density[x + 16 * z])
+                            && getBlockAt(x, y, z) == STONE) {
+                        // The deepest caves are flooded with lava
+                        setBlockAt(x, y, z, y < LAVA_LEVEL ? LAVA : EMPTY);
+                    }
+                }
             }
         }
     }
-    return surfletSum;
-}
-float random3f(glm::vec3 p){
-    return glm::fract(sin(glm::dot(p, glm::vec3(127.1, 311.7,212.2))) *
-     43758.5453);
-}
 
-glm::vec3 random3(glm::vec3 i){
-    return glm::vec3(random3f(i),random3f(glm::vec3(i[1],i[2],i[0])),random3f(glm::vec3(i[2],i[0],i[1])));
+    recordCaveTime(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       std::chrono::steady_clock::now() - start).count());
 }
-
-float surflet3D(glm::vec3 p, glm::vec3 gridPoint) {
- // Compute the distance between p and the grid point along each axis, and warp it with a
- // quintic function so we can smooth our cells
-     glm::vec3 t2 = glm::abs(p - gridPoint);
-     glm::vec3 t = glm::vec3(1.f) - 6.f * glm::vec3(pow(t2[0], 5.f),pow(t2[1], 5.f),pow(t2[2], 5.f)) + 15.f * glm::vec3(pow(t2[0], 4.f),pow(t2[1], 4.f),pow(t2[2], 4.f)) - 10.f * glm::vec3(pow(t2[0], 3.f),pow(t2[1], 3.f),pow(t2[2], 3.f));
-     // Get the random vector for the grid point (assume we wrote a function random2
-     // that returns a vec2 in the range [0, 1])
-     glm::vec3 gradient = random3(gridPoint) * 2.f - glm::vec3(1.f, 1.f, 1.f);
-     // Get the vector from the grid point to P
-     glm::vec3 diff = p - gridPoint;
-     // Get the value of our height field by dotting grid->P with our gradient
-     float height = glm::dot(diff, gradient);
-     // Scale our height field (i.e. reduce it) by our polynomial falloff function
-     return height * t.x * t.y * t.z;
-}
-
@@ -2,28 +2,31 @@
 #include "drawable.h"
 #include "smartpointerhelp.h"
 #include "glm_includes.h"
+#include "zonemap.h"
+#include "blockregistry.h"
+#include "palettedblocks.h"
+#include "blocklayout.h"
 #include <array>
+#include <atomic>
+#include <memory>
 #include <unordered_map>
 #include <cstddef>
 #include <iostream>
 
 class Chunk;
+struct ChunkSnapshot;
 //using namespace std;
 
-// C++ 11 allows us to define the size of an enum. This lets us use only one byte
-// of memory to store our different block types. By default, the size of a C++ enum
-// is that of an int (so, usually four bytes). This *does* limit us to only 256 different
-// block types, but in the scope of this project we'll never get anywhere near that many.
-enum BlockType : unsigned char
-{
-    EMPTY, GRASS, DIRT, STONE, WATER, LAVA, BEDROCK, SAND, SNOW
-};
-
-// The six cardinal directions in 3D space
-enum Direction : unsigned char
-{
-    XPOS, XNEG, YPOS, YNEG, ZPOS, ZNEG
-};
+// Helper functions to convert (x, z) to and from hash map key.
+// The upper 32 bits of the key are x and the lower 32 bits are z.
+// Inline, since every block lookup by world coordinates builds one.
+inline int64_t toKey(int x, int z) {
+    return static_cast<int64_t>((static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32)
+                                | static_cast<uint32_t>(z));
+}
+inline glm::ivec2 toCoords(int64_t k) {
+    return glm::ivec2(static_cast<int32_t>(k >> 32), static_cast<int32_t>(static_cast<uint32_t>(k)));
+}
 
 // Lets us use any enum class as the key of a
 // std::unordered_map
@@ -40,16 +43,151 @@ struct Neighbor {
     std::array<glm::ivec3, 4> vertPos;
 };
 
+// A block that decoration wants to place in a Chunk, given in that
+// Chunk's local coordinates. It is only placed if the block currently
+// there is of type replaces, so e.g. leaves never overwrite terrain.
+struct BlockWrite {
+    unsigned char x, y, z;
+    BlockType type;
+    BlockType replaces;
+};
+
+// A Chunk's blocks plus a one-block border on every side holding the
+// blocks of its four neighbors, or EMPTY where there are none, so the
+// mesher can look at any neighbor of any block with a plain indexed read.
+// Indexed (y + 1) + 258 * (z + 1) + 258 * 18 * (x + 1), so y is innermost
+// like the mesher's walk, and moving one block along an axis is a
+// constant offset.
+struct PaddedBlockView {
+    static constexpr int STRIDE_Y = 1;
+    static constexpr int STRIDE_Z = 258;
+    static constexpr int STRIDE_X = 258 * 18;
+    static constexpr int SIZE = 258 * 18 * 18;
+
+    std::vector<BlockType> blocks;
+
+    PaddedBlockView() : blocks(SIZE, EMPTY) {}
+    // x and z may be -1 to 16, y -1 to 256
+    static int index(int x, int y, int z) {
+        return (y + 1) * STRIDE_Y + (z + 1) * STRIDE_Z + (x + 1) * STRIDE_X;
+    }
+};
+
+// One bit per block of a Chunk for each of the properties meshing,
+// collision and raycasts test: whether the block is there at all (not
+// EMPTY), and whether it is opaque. Each column x + 16 * z holds its 256
+// blocks in WORDS words, block y in bit y % 64 of word y / 64. The Chunk
+// keeps them up to date as it is written, so they are built only once.
+struct BlockMasks {
+    static constexpr int WORDS = 4;
+    typedef std::array<uint64_t, WORDS> Column;
+
+    std::array<Column, 256> present;
+    std::array<Column, 256> opaque;
+
+    // From scratch, from a Chunk's 16 sections
+    void build(const std::array<std::shared_ptr<PalettedBlocks>, 16> &sections);
+    // Blocks yMin to yMax - 1 of column (x, z) were set to t, or only
+    // those of them that were EMPTY if ifEmpty
+    void fill(int x, int z, int yMin, int yMax, BlockType t, bool ifEmpty);
+    bool has(int x, int y, int z) const {
+        return (present[x + 16 * z][y >> 6] >> (y & 63)) & 1;
+    }
+};
+
+// The BlockMasks of a Chunk and of the border columns of its neighbors,
+// for the mesher: one column per column of a PaddedBlockView, EMPTY
+// where there is no neighbor. Comparing a column with the one beside it
+// takes an AND per 64 blocks, and with the blocks above or below it a shift.
+struct OccupancyMasks {
+    static constexpr int WORDS = BlockMasks::WORDS;
+    typedef BlockMasks::Column Column;
+
+    std::vector<Column> present;
+    std::vector<Column> opaque;
+
+    OccupancyMasks() : present(18 * 18, Column{}), opaque(18 * 18, Column{}) {}
+    // Copies the masks of snapshot and its neighbors' borders
+    void build(const ChunkSnapshot &snapshot);
+    // x and z may be -1 to 16
+    static int index(int x, int z) {
+        return (x + 1) * 18 + (z + 1);
+    }
+    // For each Direction, the blocks of column (x, z) with a visible face
+    // on that side: those that are not EMPTY while their neighbor on that
+    // side is not opaque. Two blocks that are both see-through (not EMPTY
+    // and not opaque, like two water blocks) hide the faces between them.
+    // x and z must be 0 to 15.
+    void faces(int x, int z, std::array<Column, 6> &out) const;
+};
+
+// How createVBOdata turns visible block faces into quads
+enum class MeshingMode : unsigned char {
+    // One quad per face
+    Naive,
+    // Adjacent faces of the same BlockType in the same plane merged into
+    // one rectangle, with the block's texture tiled across it. Far fewer
+    // vertices on flat ground and water, but slower to mesh.
+    Greedy
+};
+
+// How createVBOdata lays out each vertex
+enum class VertexFormat : unsigned char {
+    // Position, normal and UV as 3 vec4s, 48 bytes
+    Float,
+    // 2 uint32s, 8 bytes, decoded by lambert.vert.glsl. The bits of each
+    // are described at packVertex in chunk.cpp.
+    Packed
+};
+
+// Everything a Chunk's mesh is built from, frozen at one version of the
+// Chunk: its sections and those of its four neighbors. The sections are
+// shared with the Chunks rather than copied, and a Chunk copies a shared
+// section before writing to it, so a snapshot never changes and can be
+// read on any thread while the Chunks are edited.
+struct ChunkSnapshot {
+    typedef std::array<std::shared_ptr<const PalettedBlocks>, 16> Sections;
+
+    uint32_t version;
+    // Chunk::meshingMode() when the snapshot was taken
+    MeshingMode meshing;
+    // Chunk::vertexFormat() when the snapshot was taken
+    VertexFormat format;
+    Sections sections;
+    // Chunk::topNonAir of every column x + 16 * z
+    std::array<int16_t, 256> topNonAir;
+    // The sections of the XPOS, XNEG, ZPOS and ZNEG neighbors,
+    // or nullptrs where there was none
+    std::array<Sections, 4> neighbors;
+    // The BlockMasks of the Chunk and of the same neighbors, shared
+    // like the sections
+    std::shared_ptr<const BlockMasks> masks;
+    std::array<std::shared_ptr<const BlockMasks>, 4> neighborMasks;
+
+    // Copies the blocks and the border blocks of the neighbors into view
+    void fillPaddedView(PaddedBlockView &view) const;
+    // Whether section s may have a visible face. Uniform sections that are
+    // empty, or solid and enclosed by solid uniform sections, have none.
+    bool sectionHasFaces(int s) const;
+};
+
 struct ChunkVBOData {
     Chunk* mp_chunk;
+    // The version of the Chunk the data was built from
+    uint32_t m_version;
+    // Which of the vertex vectors below are filled in
+    VertexFormat m_format;
     //without opaue and transparent yet
     std::vector<glm::vec4> m_trans;
     std::vector<glm::vec4> m_op;
+    std::vector<glm::uvec2> m_transPacked;
+    std::vector<glm::uvec2> m_opPacked;
 
     std::vector<GLuint> m_transIdx;
     std::vector<GLuint> m_opIdx;
 
-    ChunkVBOData(Chunk* c): mp_chunk(c), m_trans{}, m_op{}, m_transIdx{}, m_opIdx{}
+    ChunkVBOData(Chunk* c): mp_chunk(c), m_version(0), m_format(VertexFormat::Float), m_trans{}, m_op{},
+        m_transPacked{}, m_opPacked{}, m_transIdx{}, m_opIdx{}
     {}
 
 };
@@ -64,78 +202,145 @@ struct ChunkVBOData {
 // TODO have Chunk inherit from Drawable
 class Chunk : public Drawable{
 private:
-    // All of the blocks contained within this Chunk
-    std::array<BlockType, 65536> m_blocks;
-    // This Chunk's four neighbors to the north, south, east, and west
-    // The third input to this map just lets us use a Direction as
-    // a key for this map.
-    // These allow us to properly determine
-    std::unordered_map<Direction, Chunk*, EnumHash> m_neighbors;
-    std::unordered_map<BlockType, std::unordered_map<Direction, glm::vec4, EnumHash>, EnumHash> m_uvs {
-        {WATER, std::unordered_map<Direction, glm::vec4, EnumHash> {{XPOS, glm::vec4(13.f/16.f, 3.f/16.f, 0, 0)},
-                                                                    {XNEG, glm::vec4(13.f/16.f, 3.f/16.f, 0, 0)},
-                                                                    {YPOS, glm::vec4(13.f/16.f, 3.f/16.f, 0, 0)},
-                                                                    {YNEG, glm::vec4(13.f/16.f, 3.f/16.f, 0, 0)},
-                                                                    {ZPOS, glm::vec4(13.f/16.f, 3.f/16.f, 0, 0)},
-                                                                    {ZNEG, glm::vec4(15.f/16.f, 3.f/16.f, 0, 0)}}},
-        {LAVA, std::unordered_map<Direction, glm::vec4, EnumHash> {{XPOS, glm::vec4(14.f/16.f, 1.f/16.f, 0, 0)},
-                                                                   {XNEG, glm::vec4(14.f/16.f, 1.f/16.f, 0, 0)},
-                                                                   {YPOS, glm::vec4(14.f/16.f, 1.f/16.f, 0, 0)},
-                                                                   {YNEG, glm::vec4(14.f/16.f, 1.f/16.f, 0, 0)},
-                                                                   {ZPOS, glm::vec4(14.f/16.f, 1.f/16.f, 0, 0)},
-                                                                   {ZNEG, glm::vec4(14.f/16.f, 1.f/16.f, 0, 0)}}},
-        {GRASS, std::unordered_map<Direction, glm::vec4, EnumHash> {{XPOS, glm::vec4(3.f/16.f, 15.f/16.f, 0, 0)},
-                                                                    {XNEG, glm::vec4(3.f/16.f, 15.f/16.f, 0, 0)},
-                                                                    {YPOS, glm::vec4(8.f/16.f, 13.f/16.f, 0, 0)},
-                                                                    {YNEG, glm::vec4(2.f/16.f, 15.f/16.f, 0, 0)},
-                                                                    {ZPOS, glm::vec4(3.f/16.f, 15.f/16.f, 0, 0)},
-                                                                    {ZNEG, glm::vec4(3.f/16.f, 15.f/16.f, 0, 0)}}},
-        {DIRT, std::unordered_map<Direction, glm::vec4, EnumHash> {{XPOS, glm::vec4(2.f/16.f, 15.f/16.f, 0, 0)},
-                                                                   {XNEG, glm::vec4(2.f/16.f, 15.f/16.f, 0, 0)},
-                                                                   {YPOS, glm::vec4(2.f/16.f, 15.f/16.f, 0, 0)},
-                                                                   {YNEG, glm::vec4(2.f/16.f, 15.f/16.f, 0, 0)},
-                                                                   {ZPOS, glm::vec4(2.f/16.f, 15.f/16.f, 0, 0)},
-                                                                   {ZNEG, glm::vec4(2.f/16.f, 15.f/16.f, 0, 0)}}},
-        {STONE, std::unordered_map<Direction, glm::vec4, EnumHash> {{XPOS, glm::vec4(1.f/16.f, 15.f/16.f, 0, 0)},
-                                                                    {XNEG, glm::vec4(1.f/16.f, 15.f/16.f, 0, 0)},
-                                                                    {YPOS, glm::vec4(1.f/16.f, 15.f/16.f, 0, 0)},
-                                                                    {YNEG, glm::vec4(1.f/16.f, 15.f/16.f, 0, 0)},
-                                                                    {ZPOS, glm::vec4(1.f/16.f, 15.f/16.f, 0, 0)},
-                                                                    {ZNEG, glm::vec4(1.f/16.f, 15.f/16.f, 0, 0)}}},
-        {SNOW, std::unordered_map<Direction, glm::vec4, EnumHash> {{XPOS, glm::vec4(2.f/16.f, 11.f/16.f, 0, 0)},
-                                                                    {XNEG, glm::vec4(2.f/16.f, 11.f/16.f, 0, 0)},
-                                                                    {YPOS, glm::vec4(2.f/16.f, 11.f/16.f, 0, 0)},
-                                                                    {YNEG, glm::vec4(2.f/16.f, 11.f/16.f, 0, 0)},
-                                                                    {ZPOS, glm::vec4(2.f/16.f, 11.f/16.f, 0, 0)},
-                                                                    {ZNEG, glm::vec4(2.f/16.f, 11.f/16.f, 0, 0)}}},
-        {SAND, std::unordered_map<Direction, glm::vec4, EnumHash> {{XPOS, glm::vec4(2.f/16.f, 14.f/16.f, 0, 0)},
-                                                                    {XNEG, glm::vec4(2.f/16.f, 14.f/16.f, 0, 0)},
-                                                                    {YPOS, glm::vec4(2.f/16.f, 14.f/16.f, 0, 0)},
-                                                                    {YNEG, glm::vec4(2.f/16.f, 14.f/16.f, 0, 0)},
-                                                                    {ZPOS, glm::vec4(2.f/16.f, 14.f/16.f, 0, 0)},
-                                                                    {ZNEG, glm::vec4(2.f/16.f, 14.f/16.f, 0, 0)}}}
-
-    };
+    // All of the blocks contained within this Chunk, split into 16
+    // sections of 16 x 16 x 16 blocks stacked from y = 0 up. Each is
+    // palette-compressed on its own and indexed by BlockLayout.
+    // Sections may be shared with snapshots, and uniform ones with every
+    // other Chunk, so they are copied before they are written to unless
+    // m_ownsSection says this Chunk is the only one that can see them.
+    std::array<std::shared_ptr<PalettedBlocks>, 16> m_sections;
+    std::array<bool, 16> m_ownsSection;
+    // The masks of our blocks, nullptr until updateMasks builds them.
+    // Shared with snapshots and copied before writing like the sections.
+    std::shared_ptr<BlockMasks> m_masks;
+    bool m_ownsMasks;
+    // This Chunk's four neighbors to the north, south, east, and west,
+    // indexed by neighborIndex(). nullptr where there is none (yet).
+    std::array<Chunk*, 4> m_neighbors;
+    // Bumped by every change that can alter this Chunk's mesh. Atomic,
+    // since linking neighbors on a worker bumps it too.
+    std::atomic<uint32_t> m_version;
+    // Per column x + 16 * z, the y of the highest block that is not
+    // EMPTY and of the highest that collides, -1 where there is none, or
+    // UNKNOWN_HEIGHT after a write that may have removed that block
+    mutable std::array<int16_t, 256> m_topNonAir;
+    mutable std::array<int16_t, 256> m_topSolid;
+    static constexpr int16_t UNKNOWN_HEIGHT = -2;
+
+    // The slot of m_neighbors for XPOS, XNEG, ZPOS or ZNEG
+    static constexpr int neighborIndex(Direction d) { return d < YPOS ? d : d - 2; }
+    // Section s, first copied if anything else can see it
+    PalettedBlocks& writableSection(int s);
+    // Updates the heights and masks of column (x, z) after blocks yMin to
+    // yMax - 1 were set to t, or only those of them that were EMPTY if ifEmpty
+    void noteColumnWrite(int x, int z, int yMin, int yMax, BlockType t, bool ifEmpty);
+    // Finds both heights of column x + 16 * z from scratch
+    void rescanColumn(int column) const;
 
 public:
     Chunk(OpenGLContext* context);
+    // Meshes a snapshot of this Chunk on the calling thread
     void createVBOdata() override;
+    // Meshes snapshot into out. Safe on any thread.
+    static void createVBOdata(const ChunkSnapshot &snapshot, ChunkVBOData &out);
+    // How snapshots taken from now on are meshed. Only call these on the
+    // main thread; Terrain::setMeshingMode also remeshes what is drawn.
+    static void setMeshingMode(MeshingMode mode);
+    static MeshingMode meshingMode();
+    // The same for the layout of their vertices
+    static void setVertexFormat(VertexFormat format);
+    static VertexFormat vertexFormat();
     void destroyVBOdata() override;
-    void createVBO(std::vector<glm::vec4> &interleaved_trans, std::vector<GLuint> &idx_trans, std::vector<glm::vec4> &interleaved_opq, std::vector<GLuint> &idx_opq);
+    // Uploads the vertices and indices of data in its format
+    void createVBO(const ChunkVBOData &data);
     GLenum drawMode() override;
+    bool packedVertices() override;
     BlockType getBlockAt(unsigned int x, unsigned int y, unsigned int z) const;
     BlockType getBlockAt(int x, int y, int z) const;
     void setBlockAt(unsigned int x, unsigned int y, unsigned int z, BlockType t);
-    void linkNeighbor(uPtr<Chunk>& neighbor, Direction dir);
-    BlockType getNeighborBlock(int x, int y, int z);
+    // Sets blocks yMin (inclusive) to yMax (exclusive) of column (x, z) to t.
+    // Much cheaper than calling setBlockAt for each block, since the
+    // bounds are only checked once.
+    void fillColumn(int x, int z, int yMin, int yMax, BlockType t);
+    // Like fillColumn, but only replaces blocks that are EMPTY
+    void fillColumnIfEmpty(int x, int z, int yMin, int yMax, BlockType t);
+    // Places each write whose target block is of the type it replaces
+    void applyBlockWrites(const std::vector<BlockWrite> &writes);
+    // Repacks the blocks as tightly as their types allow. Worth calling
+    // once generation is done, since carving and decoration can leave
+    // block types behind that no block uses any more.
+    void compactBlocks();
+    // Unpacks all 65536 blocks into out, one section after another
+    void decodeBlocks(BlockType *out) const;
+    // Where block (x, y, z) ends up in the output of decodeBlocks
+    static int decodedIndex(int x, int y, int z) {
+        return BlockLayout::index(x, y & 15, z) + 4096 * (y >> 4);
+    }
+    // Bytes used to store the blocks and their masks
+    size_t blockBytes() const;
+    // The y of the highest block of column (x, z) that is not EMPTY, or
+    // that collides, or -1 if there is none. Writes keep these up to
+    // date in O(1) unless they remove that very block, and then the
+    // column is scanned again the next time it is asked for. Like
+    // writes, only call these on the thread that owns the Chunk.
+    int topNonAir(int x, int z) const;
+    int topSolid(int x, int z) const;
+    // Scans every column a write has left unknown, e.g.
+    // once generation is done with the Chunk
+    void updateHeights() const;
+    // Builds the BlockMasks if they aren't yet, e.g. once generation is
+    // done with the Chunk. Writes keep them up to date from then on.
+    void updateMasks();
+    // Whether block (x, y, z) is not EMPTY, from the masks if they are built
+    bool hasBlockAt(int x, int y, int z) const;
+    // The blocks with y from 16 * i to 16 * i + 15
+    const PalettedBlocks& section(int i) const { return *m_sections[i]; }
+    static constexpr int SECTION_COUNT = 16;
+    // Does nothing if neighbor is nullptr. May run on any thread, but
+    // never alongside a snapshot of either Chunk or another link of them.
+    void linkNeighbor(Chunk *neighbor, Direction dir);
+    // Clears our neighbor pointers and theirs to us, before we are
+    // destroyed. Like linkNeighbor, never alongside a snapshot or link.
+    void unlinkNeighbors();
+    // Freezes our blocks and those of our neighbors for meshing. Must be
+    // called on the thread that writes this Chunk and its neighbors.
+    ChunkSnapshot snapshot();
+    uint32_t version() const { return m_version; }
+    // For changes to our neighbors that show in our mesh, such as
+    // an edit on their side of our shared border
+    void bumpVersion() { m_version++; }
     void generateTestTerrain(glm::ivec2 chunkPos);
     glm::ivec2 m_position; // temp
     ChunkVBOData m_chunkVBOData;
 
     bool hasVBOdata;
+    // Bytes of vertices and indices last uploaded by createVBO
+    size_t m_vboBytes;
+    // The format of the vertices last uploaded by createVBO
+    VertexFormat m_vboFormat;
+    // Whether generation is done with our blocks, so that the main thread
+    // may read, edit and snapshot them. Only set by Terrain.
+    bool hasBlockData;
+    // How much Terrain's edits have changed blockBytes() since then
+    int64_t m_editedBytes;
 
     friend class Terrain;
 
-    void GenerateChunkAt(glm::vec2 xz);
+    // Fills this Chunk's blocks using the precomputed
+    // height and biome maps of the zone it belongs to.
+    // Runs fillTerrain and carveCaves back to back.
+    void GenerateChunkAt(glm::vec2 xz, const ZoneMap &zoneMap);
+    // Stone, biome layers and water of every column
+    void fillTerrain(glm::ivec2 chunkPos, const ZoneMap &zoneMap);
+    // Carves caves out of the stone of each column, staying CAVE_ROOF
+    // blocks below its surface, with lava below LAVA_LEVEL.
+    // The time taken is added to caveStats().
+    void carveCaves(glm::ivec2 chunkPos, const ZoneMap &zoneMap);
+
+    // Caves stay at least this many blocks below the surface
+    static constexpr int CAVE_ROOF = 6;
+    static constexpr int LAVA_LEVEL = 25;
+    // Empty space below this height is filled with water
+    static constexpr int WATER_LEVEL = 139;
 
 };
@@ -0,0 +1,40 @@
+#include "chunkdirectory.h"
+#include <QMutexLocker>
+
+ChunkDirectory::ChunkDirectory()
+    : m_shards()
+{}
+
+void ChunkDirectory::insert(int x, int z, Chunk *c) {
+    Shard &shard = m_shards[shardOf(x, z)];
+    QMutexLocker locker(&shard.lock);
+    shard.chunks[toKey(x & ~15, z & ~15)] = c;
+}
+
+Chunk* ChunkDirectory::erase(int x, int z) {
+    Shard &shard = m_shards[shardOf(x, z)];
+    QMutexLocker locker(&shard.lock);
+    auto it = shard.chunks.find(toKey(x & ~15, z & ~15));
+    if(it == shard.chunks.end()) {
+        return nullptr;
+    }
+    Chunk *c = it->second;
+    shard.chunks.erase(it);
+    return c;
+}
+
+Chunk* ChunkDirectory::find(int x, int z) const {
+    const Shard &shard = m_shards[shardOf(x, z)];
+    QMutexLocker locker(&shard.lock);
+    auto it = shard.chunks.find(toKey(x & ~15, z & ~15));
+    return it != shard.chunks.end() ? it->second : nullptr;
+}
+
+size_t ChunkDirectory::size() const {
+    size_t count = 0;
+    for(const Shard &shard : m_shards) {
+        QMutexLocker locker(&shard.lock);
+        count += shard.chunks.size();
+    }
+    return count;
+}
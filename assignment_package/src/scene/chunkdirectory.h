@@ -0,0 +1,49 @@
+#pragma once
+#include "chunk.h"
+#include <QMutex>
+#include <array>
+#include <cstdint>
+#include <unordered_map>
+
+// Finds Chunks by world-space coordinates from any thread, so that
+// workers can look up a Chunk or its neighbors without going through
+// the main thread. Terrain's workers add the Chunks they make here, and
+// find the neighbors to link them to here.
+//
+// The Chunks are spread over SHARDS hash maps with a lock each, by the
+// low 2 bits of their x and z chunk coordinates, so a Chunk and its 8
+// neighbors always sit in different shards and threads working on
+// nearby Chunks rarely wait for one another.
+//
+// Only the directory itself is thread safe. Whoever erases a Chunk must
+// make sure no other thread still uses a pointer it found before that.
+class ChunkDirectory {
+public:
+    static constexpr int SHARDS = 16;
+
+    ChunkDirectory();
+
+    ChunkDirectory(const ChunkDirectory&) = delete;
+    ChunkDirectory& operator=(const ChunkDirectory&) = delete;
+
+    // Stores the Chunk whose lower-left corner is (x, z)
+    void insert(int x, int z, Chunk *c);
+    // Removes that Chunk, returning it, or nullptr if there was none
+    Chunk* erase(int x, int z);
+    // The Chunk containing world-space (x, z), or nullptr if there is none
+    Chunk* find(int x, int z) const;
+    size_t size() const;
+
+private:
+    // Each on its own cache line, so that locking one
+    // shard does not slow down threads using another
+    struct alignas(64) Shard {
+        mutable QMutex lock;
+        std::unordered_map<int64_t, Chunk*> chunks;
+    };
+    std::array<Shard, SHARDS> m_shards;
+
+    static int shardOf(int x, int z) {
+        return ((x >> 4) & 3) | (((z >> 4) & 3) << 2);
+    }
+};
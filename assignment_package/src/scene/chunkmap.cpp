@@ -0,0 +1,67 @@
+#include "chunkmap.h"
+
+ChunkMap::ChunkMap(const ChunkPool &pool)
+    : m_pool(pool), m_entries(), m_lastKey(0), mp_lastChunk(nullptr),
+      m_residentX(-RESIDENT_SIZE / 2), m_residentZ(-RESIDENT_SIZE / 2),
+      m_resident(RESIDENT_SIZE * RESIDENT_SIZE, nullptr)
+{}
+
+void ChunkMap::insert(int x, int z, ChunkHandle handle) {
+    const int64_t key = toKey(x, z);
+    Chunk *c = m_pool.get(handle);
+    m_entries[key] = {handle, c};
+    if(key == m_lastKey) {
+        mp_lastChunk = nullptr;
+    }
+    if(isResident(x >> 4, z >> 4)) {
+        m_resident[residentSlot(x >> 4, z >> 4)] = c;
+    }
+}
+
+ChunkHandle ChunkMap::erase(int x, int z) {
+    const int64_t key = toKey(x, z);
+    auto it = m_entries.find(key);
+    if(it == m_entries.end()) {
+        return ChunkHandle();
+    }
+    const ChunkHandle handle = it->second.handle;
+    m_entries.erase(it);
+    if(key == m_lastKey) {
+        mp_lastChunk = nullptr;
+    }
+    if(isResident(x >> 4, z >> 4)) {
+        m_resident[residentSlot(x >> 4, z >> 4)] = nullptr;
+    }
+    return handle;
+}
+
+void ChunkMap::recenter(int x, int z) {
+    const int oldX = m_residentX, oldZ = m_residentZ;
+    m_residentX = (x >> 4) - RESIDENT_SIZE / 2;
+    m_residentZ = (z >> 4) - RESIDENT_SIZE / 2;
+    if(m_residentX == oldX && m_residentZ == oldZ) {
+        return;
+    }
+    // Slots already covered before keep their Chunk,
+    // the ones that scrolled in are looked up
+    for(int cx = m_residentX; cx < m_residentX + RESIDENT_SIZE; cx++) {
+        const bool wasColumnResident = static_cast<unsigned>(cx - oldX) < RESIDENT_SIZE;
+        for(int cz = m_residentZ; cz < m_residentZ + RESIDENT_SIZE; cz++) {
+            if(wasColumnResident && static_cast<unsigned>(cz - oldZ) < RESIDENT_SIZE) {
+                continue;
+            }
+            auto it = m_entries.find(toKey(16 * cx, 16 * cz));
+            m_resident[residentSlot(cx, cz)] = it != m_entries.end() ? it->second.chunk : nullptr;
+        }
+    }
+}
+
+Chunk* ChunkMap::findUncached(int64_t key) const {
+    auto it = m_entries.find(key);
+    if(it == m_entries.end()) {
+        return nullptr;
+    }
+    m_lastKey = key;
+    mp_lastChunk = it->second.chunk;
+    return mp_lastChunk;
+}
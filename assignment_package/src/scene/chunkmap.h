@@ -0,0 +1,107 @@
+#pragma once
+#include "chunkpool.h"
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Finds Chunks by any world-space coordinates. Each Chunk is stored under
+// toKey of its lower-left corner, which is found with integer arithmetic
+// only: clearing the low 4 bits of a coordinate rounds it down to a
+// multiple of 16, negative coordinates included, which is exactly what
+// glm::floor(x / 16.f) * 16 computes.
+//
+// Physics, rays and block edits mostly query blocks close to the last one,
+// so the last Chunk found is remembered and returned without hashing as
+// long as the next query falls into it as well.
+//
+// The Chunks around the player are also kept in a RESIDENT_SIZE^2 grid of
+// slots, which are found by index instead of by hash and can be iterated
+// without touching the Chunks of zones left long ago. The grid is a ring
+// buffer: chunk (cx, cz) always lives in slot (cx mod RESIDENT_SIZE,
+// cz mod RESIDENT_SIZE), so when recenter() moves it by a Chunk only the
+// row or column scrolling in is looked up again. Every Chunk stays in the
+// hash map as well, so nothing is lost when it scrolls out.
+//
+// Not thread safe, not even find(), since it updates that cache. Use it
+// on the thread that owns the Chunks, i.e. the main thread. Workers find
+// Chunks through a ChunkDirectory instead.
+class ChunkMap {
+public:
+    // A Chunk's handle, and the Chunk it referred to when inserted
+    struct Entry {
+        ChunkHandle handle;
+        Chunk *chunk;
+    };
+    typedef std::unordered_map<int64_t, Entry>::const_iterator const_iterator;
+
+    // Chunks are looked up in pool
+    explicit ChunkMap(const ChunkPool &pool);
+
+    // Chunks per side of the resident grid. The 5 x 5 zones Terrain draws
+    // around the player's zone span 20 Chunks, and the player can be in any
+    // of the 4 Chunks of their zone along each axis, so 24 always covers them.
+    static constexpr int RESIDENT_SIZE = 24;
+
+    // The lower-left corner of the Chunk containing coordinate v
+    static int chunkOrigin(int v) { return v & ~15; }
+
+    // The Chunk containing world-space (x, z), or nullptr if there is none
+    Chunk* find(int x, int z) const {
+        const int64_t key = toKey(chunkOrigin(x), chunkOrigin(z));
+        if(mp_lastChunk != nullptr && key == m_lastKey) {
+            return mp_lastChunk;
+        }
+        const int cx = x >> 4, cz = z >> 4;
+        if(isResident(cx, cz)) {
+            Chunk *c = m_resident[residentSlot(cx, cz)];
+            if(c != nullptr) {
+                m_lastKey = key;
+                mp_lastChunk = c;
+            }
+            return c;
+        }
+        return findUncached(key);
+    }
+    bool contains(int x, int z) const { return find(x, z) != nullptr; }
+
+    // Stores the Chunk whose lower-left corner is (x, z)
+    void insert(int x, int z, ChunkHandle handle);
+    // Removes that Chunk, returning its handle, which is null if there was none
+    ChunkHandle erase(int x, int z);
+
+    // Centers the resident grid on the Chunk containing world-space (x, z)
+    void recenter(int x, int z);
+    // Every slot of the resident grid, in no particular order,
+    // holding nullptr where there is no Chunk
+    const std::vector<Chunk*>& resident() const { return m_resident; }
+
+    // Iterates over (toKey of the corner, Entry) pairs
+    const_iterator begin() const { return m_entries.begin(); }
+    const_iterator end() const { return m_entries.end(); }
+    size_t size() const { return m_entries.size(); }
+
+private:
+    const ChunkPool &m_pool;
+    // The Chunk is kept next to its handle, so that finding
+    // it does not have to take the pool's lock
+    std::unordered_map<int64_t, Entry> m_entries;
+    // The last Chunk find() returned, and its key
+    mutable int64_t m_lastKey;
+    mutable Chunk *mp_lastChunk;
+    // The lowest chunk coordinates (world-space / 16) the grid covers
+    int m_residentX, m_residentZ;
+    std::vector<Chunk*> m_resident;
+
+    bool isResident(int cx, int cz) const {
+        return static_cast<unsigned>(cx - m_residentX) < RESIDENT_SIZE
+            && static_cast<unsigned>(cz - m_residentZ) < RESIDENT_SIZE;
+    }
+    static int residentSlot(int cx, int cz) {
+        return wrap(cx) + RESIDENT_SIZE * wrap(cz);
+    }
+    static int wrap(int c) {
+        const int r = c % RESIDENT_SIZE;
+        return r < 0 ? r + RESIDENT_SIZE : r;
+    }
+    Chunk* findUncached(int64_t key) const;
+};
@@ -0,0 +1,69 @@
+#include "chunkpool.h"
+#include <QMutexLocker>
+#include <new>
+
+ChunkPool::ChunkPool(OpenGLContext *context)
+    : mp_context(context), m_lock(), m_arenas(), m_generations(), m_freeSlots(), m_counters()
+{}
+
+ChunkPool::~ChunkPool() {
+    for(uint32_t slot = 0; slot < m_generations.size(); slot++) {
+        if(m_generations[slot] & 1) {
+            chunkIn(slot)->~Chunk();
+        }
+    }
+}
+
+ChunkHandle ChunkPool::acquire() {
+    QMutexLocker locker(&m_lock);
+    uint32_t slot;
+    if(!m_freeSlots.empty()) {
+        slot = m_freeSlots.back();
+        m_freeSlots.pop_back();
+        m_counters.recycled++;
+    } else {
+        if(m_generations.size() == m_arenas.size() * ARENA_CHUNKS) {
+            m_arenas.push_back(std::unique_ptr<Slot[]>(new Slot[ARENA_CHUNKS]));
+            m_counters.arenas++;
+            m_counters.capacity += ARENA_CHUNKS;
+        }
+        slot = static_cast<uint32_t>(m_generations.size());
+        m_generations.push_back(0);
+    }
+    new (chunkIn(slot)) Chunk(mp_context);
+    m_generations[slot]++;
+    m_counters.acquired++;
+    m_counters.live++;
+    return ChunkHandle(slot, m_generations[slot]);
+}
+
+void ChunkPool::release(ChunkHandle handle) {
+    QMutexLocker locker(&m_lock);
+    if(!isLive(handle)) {
+        return;
+    }
+    chunkIn(handle.slot)->~Chunk();
+    m_generations[handle.slot]++;
+    m_freeSlots.push_back(handle.slot);
+    m_counters.released++;
+    m_counters.live--;
+}
+
+Chunk* ChunkPool::get(ChunkHandle handle) const {
+    QMutexLocker locker(&m_lock);
+    return isLive(handle) ? chunkIn(handle.slot) : nullptr;
+}
+
+ChunkPoolCounters ChunkPool::counters() const {
+    QMutexLocker locker(&m_lock);
+    return m_counters;
+}
+
+bool ChunkPool::isLive(ChunkHandle handle) const {
+    return handle.slot < m_generations.size() && m_generations[handle.slot] == handle.generation
+        && (handle.generation & 1);
+}
+
+Chunk* ChunkPool::chunkIn(uint32_t slot) const {
+    return std::launder(reinterpret_cast<Chunk*>(m_arenas[slot / ARENA_CHUNKS][slot % ARENA_CHUNKS].bytes));
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include "chunk.h"
+#include <QMutex>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Refers to a Chunk handed out by a ChunkPool. A handle outlives its Chunk
+// safely: once the Chunk is released, ChunkPool::get returns nullptr for
+// it, even if its slot has been reused by another Chunk since.
+struct ChunkHandle {
+    uint32_t slot;
+    // Which use of the slot this handle refers to
+    uint32_t generation;
+
+    ChunkHandle() : slot(UINT32_MAX), generation(0) {}
+    ChunkHandle(uint32_t slot, uint32_t generation) : slot(slot), generation(generation) {}
+    bool isNull() const { return slot == UINT32_MAX; }
+};
+
+// Running totals of what a ChunkPool has done
+struct ChunkPoolCounters {
+    // Arenas allocated, each holding ChunkPool::ARENA_CHUNKS Chunks
+    uint64_t arenas;
+    uint64_t acquired;
+    uint64_t released;
+    // Acquisitions served from the free list rather than a fresh slot
+    uint64_t recycled;
+    // Chunks currently alive, and slots available in all arenas
+    uint64_t live;
+    uint64_t capacity;
+};
+
+// Owns Chunks in arenas of ARENA_CHUNKS slots each, so exploring the world
+// costs one large allocation per ARENA_CHUNKS Chunks instead of one per
+// Chunk. The slots of released Chunks go on a free list and are reused
+// before any new arena is allocated, and arenas are never given back.
+//
+// Thread safe: one lock guards the arenas and free list, so Chunks can be
+// acquired on the workers that generate them and released on the main
+// thread. Chunk pointers may be used from any thread until their release.
+class ChunkPool {
+public:
+    static constexpr int ARENA_CHUNKS = 64;
+
+    // Every Chunk is constructed with this context
+    ChunkPool(OpenGLContext *context);
+    // Destroys every Chunk that is still alive
+    ~ChunkPool();
+
+    ChunkPool(const ChunkPool&) = delete;
+    ChunkPool& operator=(const ChunkPool&) = delete;
+
+    // Constructs a new, EMPTY Chunk
+    ChunkHandle acquire();
+    // Destroys the Chunk. Does nothing if it was already released.
+    void release(ChunkHandle handle);
+    // The Chunk, or nullptr if it has been released
+    Chunk* get(ChunkHandle handle) const;
+
+    ChunkPoolCounters counters() const;
+
+private:
+    // Uninitialized storage for one Chunk
+    struct Slot {
+        alignas(Chunk) unsigned char bytes[sizeof(Chunk)];
+    };
+
+    OpenGLContext *mp_context;
+    // Guards everything below
+    mutable QMutex m_lock;
+    std::vector<std::unique_ptr<Slot[]>> m_arenas;
+    // Per slot, bumped on every release. Odd while a Chunk lives in it.
+    std::vector<uint32_t> m_generations;
+    std::vector<uint32_t> m_freeSlots;
+    ChunkPoolCounters m_counters;
+
+    Chunk* chunkIn(uint32_t slot) const;
+    // Whether handle refers to the Chunk in its slot. Call with m_lock held.
+    bool isLive(ChunkHandle handle) const;
+};
@@ -0,0 +1,107 @@
+#include "decorator.h"
+#include "noise.h"
+
+// Mixed into the world seed so every feature gets its own random stream
+static const uint32_t TREE_SALT = 0x7EE5u;
+static const uint32_t VEIN_SALT = 0xC0A1u;
+
+// One tree on average per TREE_RARITY grass columns
+static const uint32_t TREE_RARITY = 96;
+static const int MAX_VEINS = 4;
+static const int VEIN_LENGTH = 10;
+
+// Sends each block either into the Chunk being decorated or, if it
+// lies outside of it, into the queue of the Chunk it falls in
+class DecorationWriter {
+public:
+    DecorationWriter(Chunk &chunk, glm::ivec2 chunkPos, SpilledWrites &spilled)
+        : m_chunk(chunk), m_chunkPos(chunkPos), m_spilled(spilled), m_local()
+    {}
+
+    ~DecorationWriter() {
+        m_chunk.applyBlockWrites(m_local);
+    }
+
+    // x and z are relative to the decorated Chunk and may fall outside it
+    void place(int x, int y, int z, BlockType type, BlockType replaces) {
+        if(y < 0 || y > 255) {
+            return;
+        }
+        // Arithmetic shifts round down, like ChunkMap's lookups
+        int cx = x >> 4;
+        int cz = z >> 4;
+        BlockWrite w = {static_cast<unsigned char>(x - 16 * cx), static_cast<unsigned char>(y),
+                        static_cast<unsigned char>(z - 16 * cz), type, replaces};
+        if(cx == 0 && cz == 0) {
+            // Applied in order at the end, so e.g. a tree's leaves
+            // see the trunk placed before them
+            m_local.push_back(w);
+        } else {
+            m_spilled[toKey(m_chunkPos.x + 16 * cx, m_chunkPos.y + 16 * cz)].push_back(w);
+        }
+    }
+
+private:
+    Chunk &m_chunk;
+    glm::ivec2 m_chunkPos;
+    SpilledWrites &m_spilled;
+    std::vector<BlockWrite> m_local;
+};
+
+static void placeTree(DecorationWriter &writer, int x, int base, int z, int height) {
+    for(int y = base; y < base + height; y++) {
+        writer.place(x, y, z, WOOD, EMPTY);
+    }
+    // Two wide layers of leaves around the top of the trunk, then two narrow ones
+    for(int y = base + height - 2; y < base + height + 2; y++) {
+        int r = y < base + height ? 2 : 1;
+        for(int dx = -r; dx <= r; dx++) {
+            for(int dz = -r; dz <= r; dz++) {
+                if(r == 2 && std::abs(dx) == 2 && std::abs(dz) == 2) {
+                    continue; // round off the corners
+                }
+                writer.place(x + dx, y, z + dz, LEAF, EMPTY);
+            }
+        }
+    }
+}
+
+static void placeVein(DecorationWriter &writer, glm::ivec3 start, uint32_t seed) {
+    glm::ivec3 p = start;
+    for(int i = 0; i < VEIN_LENGTH; i++) {
+        writer.place(p.x, p.y, p.z, COAL, STONE);
+        uint32_t h = hashCoords(i, static_cast<int32_t>(seed), seed);
+        p += glm::ivec3(h % 3, (h >> 8) % 3, (h >> 16) % 3) - glm::ivec3(1);
+    }
+}
+
+void decorateChunk(Chunk &chunk, glm::ivec2 chunkPos, const ZoneMap &zoneMap, SpilledWrites &spilled) {
+    const uint32_t seed = noiseBackend().seed;
+    glm::ivec2 zoneOffset = chunkPos - zoneMap.zonePos();
+    DecorationWriter writer(chunk, chunkPos, spilled);
+
+    for(int z = 0; z < 16; z++) {
+        for(int x = 0; x < 16; x++) {
+            if(zoneMap.biomeAt(zoneOffset.x + x, zoneOffset.y + z) != Grass) {
+                continue;
+            }
+            uint32_t h = hashCoords(chunkPos.x + x, chunkPos.y + z, seed + TREE_SALT);
+            if(h % TREE_RARITY != 0) {
+                continue;
+            }
+            // Only on dry grass, not on the bottom of a lake or in a cave
+            int top = static_cast<int>(zoneMap.heightAt(zoneOffset.x + x, zoneOffset.y + z));
+            if(top > 250 || chunk.getBlockAt(x, top, z) != GRASS || chunk.getBlockAt(x, top + 1, z) != EMPTY) {
+                continue;
+            }
+            placeTree(writer, x, top + 1, z, 4 + static_cast<int>((h >> 16) % 3));
+        }
+    }
+
+    uint32_t veins = hashCoords(chunkPos.x, chunkPos.y, seed + VEIN_SALT);
+    for(int i = 0; i < static_cast<int>(veins % (MAX_VEINS + 1)); i++) {
+        uint32_t h = hashCoords(chunkPos.x + i, chunkPos.y, seed + VEIN_SALT + 1);
+        glm::ivec3 start(h % 16, 8 + (h >> 4) % 100, (h >> 12) % 16);
+        placeVein(writer, start, h);
+    }
+}
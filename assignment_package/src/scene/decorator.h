@@ -0,0 +1,16 @@
+#pragma once
+#include "chunk.h"
+#include "zonemap.h"
+#include <unordered_map>
+#include <vector>
+
+// Writes that decorating one Chunk spilled over into other Chunks,
+// keyed by the toKey() of the Chunk they belong to
+typedef std::unordered_map<int64_t, std::vector<BlockWrite>> SpilledWrites;
+
+// Places trees and coal veins in a Chunk that has been filled and carved.
+// Blocks inside the Chunk are written directly, while blocks that land in
+// a neighbor are added to spilled so that neighbor can apply them itself.
+// Never touches any other Chunk, so it can run alongside the decoration
+// of its neighbors without locking.
+void decorateChunk(Chunk &chunk, glm::ivec2 chunkPos, const ZoneMap &zoneMap, SpilledWrites &spilled);
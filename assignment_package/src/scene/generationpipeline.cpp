@@ -0,0 +1,464 @@
+#include "generationpipeline.h"
+#include "stageworker.h"
+#include <algorithm>
+#include <chrono>
+#include <unordered_set>
+
+const char* genStageName(GenStage stage) {
+    switch(stage) {
+    case GenStage::Heightmap:
+        return "heightmap";
+    case GenStage::Terrain:
+        return "terrain";
+    case GenStage::Carving:
+        return "carving";
+    case GenStage::Decoration:
+        return "decoration";
+    case GenStage::Light:
+        return "light";
+    default:
+        return "finished";
+    }
+}
+
+// The lower-left corner of the zone containing a Chunk. Clearing the low
+// 6 bits rounds down to a multiple of 64, negative coordinates included.
+static glm::ivec2 zoneOf(glm::ivec2 chunkPos) {
+    return glm::ivec2(chunkPos.x & ~63, chunkPos.y & ~63);
+}
+
+GenerationPipeline::GenerationPipeline(QThreadPool *pool, std::function<void(Chunk*)> onChunkFinished)
+    : mp_pool(pool), m_onChunkFinished(onChunkFinished), m_lock(), m_idle(),
+      m_chunks(), m_zoneMaps(), m_pendingWrites(), m_chunkFactories(), m_loadedZones(), m_deferredWrites(0), m_queuedWrites(0), m_chunkBytes(0),
+      m_notifying(0), m_timings(),
+      m_tasksInFlight(0), m_stopping(false)
+{}
+
+GenerationPipeline::~GenerationPipeline() {
+    m_lock.lock();
+    m_stopping = true;
+    while(m_tasksInFlight > 0) {
+        m_idle.wait(&m_lock);
+    }
+    m_lock.unlock();
+}
+
+void GenerationPipeline::addZone(glm::ivec2 zonePos, const std::vector<Chunk*> &chunks) {
+    m_lock.lock();
+    addChunks(zonePos, chunks);
+    m_lock.unlock();
+}
+
+void GenerationPipeline::addZone(glm::ivec2 zonePos, ChunkFactory makeChunk) {
+    m_lock.lock();
+    m_chunkFactories[toKey(zonePos.x, zonePos.y)] = makeChunk;
+    addChunks(zonePos, {});
+    m_lock.unlock();
+}
+
+void GenerationPipeline::addLoadedZone(glm::ivec2 zonePos, ChunkFactory makeChunk, ZoneLoader load) {
+    m_lock.lock();
+    m_chunkFactories[toKey(zonePos.x, zonePos.y)] = makeChunk;
+    m_loadedZones[toKey(zonePos.x, zonePos.y)] = load;
+    addChunks(zonePos, {});
+    m_lock.unlock();
+}
+
+void GenerationPipeline::addChunks(glm::ivec2 zonePos, const std::vector<Chunk*> &chunks) {
+    if(!m_stopping) {
+        for(int x = zonePos.x; x < zonePos.x + 64; x += 16) {
+            for(int z = zonePos.y; z < zonePos.y + 64; z += 16) {
+                m_chunks[toKey(x, z)] = {nullptr, glm::ivec2(x, z), GenStage::Heightmap, false, false, 0};
+            }
+        }
+        for(Chunk *c : chunks) {
+            m_chunks.at(toKey(c->m_position.x, c->m_position.y)).chunk = c;
+        }
+        startTask(toKey(zonePos.x, zonePos.y), GenStage::Heightmap);
+    }
+}
+
+bool GenerationPipeline::removeZone(glm::ivec2 zonePos) {
+    QMutexLocker locker(&m_lock);
+    // A callback may be about to hand over one of its Chunks
+    if(m_notifying > 0) {
+        return false;
+    }
+    for(int x = zonePos.x; x < zonePos.x + 64; x += 16) {
+        for(int z = zonePos.y; z < zonePos.y + 64; z += 16) {
+            auto it = m_chunks.find(toKey(x, z));
+            // Heightmap Chunks are waiting for their zone's task
+            if(it != m_chunks.end() && (it->second.running || it->second.stage == GenStage::Heightmap)) {
+                return false;
+            }
+        }
+    }
+    for(int x = zonePos.x; x < zonePos.x + 64; x += 16) {
+        for(int z = zonePos.y; z < zonePos.y + 64; z += 16) {
+            auto it = m_chunks.find(toKey(x, z));
+            if(it != m_chunks.end()) {
+                m_chunkBytes -= it->second.bytes;
+                m_chunks.erase(it);
+            }
+        }
+    }
+    // The Chunks bordering the zone have lost an edge neighbor
+    for(int i = 0; i < 64; i += 16) {
+        const glm::ivec2 border[] = {{zonePos.x - 16, zonePos.y + i}, {zonePos.x + 64, zonePos.y + i},
+                                     {zonePos.x + i, zonePos.y - 16}, {zonePos.x + i, zonePos.y + 64}};
+        for(const glm::ivec2 &pos : border) {
+            auto it = m_chunks.find(toKey(pos.x, pos.y));
+            if(it != m_chunks.end()) {
+                it->second.notified = false;
+            }
+        }
+    }
+    m_zoneMaps.erase(toKey(zonePos.x, zonePos.y));
+    dropDeadWrites(zonePos);
+    return true;
+}
+
+void GenerationPipeline::dropDeadWrites(glm::ivec2 zonePos) {
+    // Decoration only spills into the 8 neighbors, so only the zone and
+    // the ring of Chunks around it can have writes to or from it
+    for(int x = zonePos.x - 16; x <= zonePos.x + 64; x += 16) {
+        for(int z = zonePos.y - 16; z <= zonePos.y + 64; z += 16) {
+            const int64_t target = toKey(x, z);
+            auto it = m_pendingWrites.find(target);
+            if(it == m_pendingWrites.end() || m_chunks.count(target) > 0) {
+                continue;
+            }
+            // A removed origin queues its writes again when it is
+            // decorated or loaded again, and the target waits for that
+            std::vector<QueuedWrites> &queues = it->second;
+            for(auto q = queues.begin(); q != queues.end();) {
+                if(m_chunks.count(q->origin) == 0) {
+                    m_queuedWrites -= q->writes.size();
+                    q = queues.erase(q);
+                } else {
+                    ++q;
+                }
+            }
+            if(queues.empty()) {
+                m_pendingWrites.erase(it);
+            }
+        }
+    }
+}
+
+void GenerationPipeline::queueSpilledWrites(int64_t origin, SpilledWrites &spilled) {
+    for(auto &target : spilled) {
+        std::vector<QueuedWrites> &queues = m_pendingWrites[target.first];
+        auto queued = std::find_if(queues.begin(), queues.end(),
+                                   [origin](const QueuedWrites &q) { return q.origin == origin; });
+        if(queued != queues.end()) {
+            // The origin was removed and decorated or loaded again
+            m_queuedWrites -= queued->writes.size();
+            m_queuedWrites += target.second.size();
+            queued->writes = move(target.second);
+        } else {
+            m_deferredWrites += target.second.size();
+            m_queuedWrites += target.second.size();
+            queues.push_back({origin, move(target.second)});
+        }
+    }
+}
+
+bool GenerationPipeline::isFinished(glm::ivec2 chunkPos) const {
+    QMutexLocker locker(&m_lock);
+    auto it = m_chunks.find(toKey(chunkPos.x, chunkPos.y));
+    return it != m_chunks.end() && it->second.stage == GenStage::Finished;
+}
+
+bool GenerationPipeline::isMeshable(glm::ivec2 chunkPos) const {
+    QMutexLocker locker(&m_lock);
+    auto it = m_chunks.find(toKey(chunkPos.x, chunkPos.y));
+    return it != m_chunks.end() && it->second.notified;
+}
+
+const ZoneMap* GenerationPipeline::zoneMapAt(glm::ivec2 zonePos) const {
+    QMutexLocker locker(&m_lock);
+    auto it = m_zoneMaps.find(toKey(zonePos.x, zonePos.y));
+    return it != m_zoneMaps.end() ? it->second.get() : nullptr;
+}
+
+uint64_t GenerationPipeline::deferredWrites() const {
+    QMutexLocker locker(&m_lock);
+    return m_deferredWrites;
+}
+
+size_t GenerationPipeline::memoryBytes() const {
+    QMutexLocker locker(&m_lock);
+    return m_chunkBytes + m_zoneMaps.size() * sizeof(ZoneMap) + m_queuedWrites * sizeof(BlockWrite)
+        + m_pendingWrites.size() * sizeof(std::vector<QueuedWrites>);
+}
+
+std::array<StageTiming, GEN_STAGE_COUNT> GenerationPipeline::stageTimings() const {
+    QMutexLocker locker(&m_lock);
+    return m_timings;
+}
+
+void GenerationPipeline::waitForIdle() {
+    m_lock.lock();
+    while(m_tasksInFlight > 0) {
+        m_idle.wait(&m_lock);
+    }
+    m_lock.unlock();
+}
+
+void GenerationPipeline::runTask(int64_t key, GenStage stage) {
+    using clock = std::chrono::steady_clock;
+    std::vector<Chunk*> finished;
+    // Only the stage's own work is timed, not waiting for m_lock
+    clock::duration elapsed;
+
+    if(stage == GenStage::Heightmap) {
+        glm::ivec2 zonePos = toCoords(key);
+        m_lock.lock();
+        ChunkFactory makeChunk;
+        auto factory = m_chunkFactories.find(key);
+        if(factory != m_chunkFactories.end()) {
+            makeChunk = move(factory->second);
+            m_chunkFactories.erase(factory);
+        }
+        ZoneLoader load;
+        auto it = m_loadedZones.find(key);
+        if(it != m_loadedZones.end()) {
+            load = move(it->second);
+            m_loadedZones.erase(it);
+        }
+        std::vector<Chunk*> chunks;
+        for(int x = zonePos.x; x < zonePos.x + 64; x += 16) {
+            for(int z = zonePos.y; z < zonePos.y + 64; z += 16) {
+                chunks.push_back(m_chunks.at(toKey(x, z)).chunk);
+            }
+        }
+        m_lock.unlock();
+
+        // Nothing else touches the zone's Chunks before this task is done
+        auto start = clock::now();
+        if(makeChunk) {
+            for(size_t i = 0; i < chunks.size(); i++) {
+                chunks[i] = makeChunk(zonePos + glm::ivec2(16 * (i / 4), 16 * (i % 4)));
+            }
+        }
+        std::unordered_set<int64_t> loaded;
+        if(load) {
+            for(Chunk *c : load(chunks)) {
+                loaded.insert(toKey(c->m_position.x, c->m_position.y));
+            }
+        }
+        uPtr<ZoneMap> zoneMap = mkU<ZoneMap>(zonePos);
+        // A loaded Chunk never decorates, so what it would spill into its
+        // neighbors is found on a scratch Chunk instead. Loaded neighbors
+        // already hold those blocks, so only the others need them.
+        std::vector<std::pair<int64_t, SpilledWrites>> loadedSpills;
+        for(int64_t chunkKey : loaded) {
+            const glm::ivec2 pos = toCoords(chunkKey);
+            bool needed = false;
+            for(int dx = -16; dx <= 16; dx += 16) {
+                for(int dz = -16; dz <= 16; dz += 16) {
+                    needed |= loaded.count(toKey(pos.x + dx, pos.y + dz)) == 0;
+                }
+            }
+            if(!needed) {
+                continue;
+            }
+            Chunk scratch(nullptr);
+            SpilledWrites spilled;
+            scratch.fillTerrain(pos, *zoneMap);
+            scratch.carveCaves(pos, *zoneMap);
+            decorateChunk(scratch, pos, *zoneMap, spilled);
+            for(auto target = spilled.begin(); target != spilled.end();) {
+                if(loaded.count(target->first) > 0) {
+                    target = spilled.erase(target);
+                } else {
+                    ++target;
+                }
+            }
+            loadedSpills.push_back({chunkKey, move(spilled)});
+        }
+        elapsed = clock::now() - start;
+
+        m_lock.lock();
+        m_zoneMaps[key] = move(zoneMap);
+        for(Chunk *c : chunks) {
+            m_chunks.at(toKey(c->m_position.x, c->m_position.y)).chunk = c;
+        }
+        for(auto &spills : loadedSpills) {
+            queueSpilledWrites(spills.first, spills.second);
+        }
+        // Loaded Chunks already hold their final blocks
+        for(int x = zonePos.x; x < zonePos.x + 64; x += 16) {
+            for(int z = zonePos.y; z < zonePos.y + 64; z += 16) {
+                ChunkState &state = m_chunks.at(toKey(x, z));
+                if(loaded.count(toKey(x, z)) > 0) {
+                    state.stage = GenStage::Finished;
+                    m_chunkBytes -= state.bytes;
+                    state.bytes = state.chunk->blockBytes();
+                    m_chunkBytes += state.bytes;
+                } else {
+                    state.stage = GenStage::Terrain;
+                }
+                tryAdvance(toKey(x, z));
+            }
+        }
+        if(!loaded.empty()) {
+            for(int x = zonePos.x - 16; x <= zonePos.x + 64; x += 16) {
+                for(int z = zonePos.y - 16; z <= zonePos.y + 64; z += 16) {
+                    tryNotify(glm::ivec2(x, z), finished);
+                    tryAdvance(toKey(x, z));
+                }
+            }
+        }
+    } else {
+        SpilledWrites spilled;
+        std::vector<BlockWrite> pending;
+
+        m_lock.lock();
+        ChunkState state = m_chunks.at(key);
+        const ZoneMap *zoneMap = m_zoneMaps.at(toKey(zoneOf(state.pos).x, zoneOf(state.pos).y)).get();
+        if(stage == GenStage::Light) {
+            // Every neighbor has been decorated, so nothing more will be queued
+            auto it = m_pendingWrites.find(key);
+            if(it != m_pendingWrites.end()) {
+                for(const QueuedWrites &queued : it->second) {
+                    pending.insert(pending.end(), queued.writes.begin(), queued.writes.end());
+                }
+            }
+        }
+        m_lock.unlock();
+
+        // Nothing else touches this Chunk's blocks while its stage runs
+        auto start = clock::now();
+        switch(stage) {
+        case GenStage::Terrain:
+            state.chunk->fillTerrain(state.pos, *zoneMap);
+            break;
+        case GenStage::Carving:
+            state.chunk->carveCaves(state.pos, *zoneMap);
+            break;
+        case GenStage::Decoration:
+            decorateChunk(*state.chunk, state.pos, *zoneMap, spilled);
+            break;
+        case GenStage::Light:
+            // Blocks that neighbors' decorations spilled into this Chunk.
+            // There is no lighting yet, but after this the Chunk is final,
+            // so its blocks are packed as tightly as they will go, and the
+            // heights carving left unknown and the block masks are found
+            // while still off the main thread.
+            state.chunk->applyBlockWrites(pending);
+            state.chunk->compactBlocks();
+            state.chunk->updateHeights();
+            state.chunk->updateMasks();
+            break;
+        default:
+            break;
+        }
+        elapsed = clock::now() - start;
+        const size_t bytes = state.chunk->blockBytes();
+
+        m_lock.lock();
+        queueSpilledWrites(key, spilled);
+        ChunkState &s = m_chunks.at(key);
+        s.stage = static_cast<GenStage>(static_cast<int>(stage) + 1);
+        s.running = false;
+        m_chunkBytes -= s.bytes;
+        s.bytes = bytes;
+        m_chunkBytes += s.bytes;
+        if(s.stage == GenStage::Finished) {
+            // This may also complete the edge neighbors of an adjacent Chunk
+            tryNotify(s.pos, finished);
+            tryNotify(s.pos + glm::ivec2(16, 0), finished);
+            tryNotify(s.pos + glm::ivec2(-16, 0), finished);
+            tryNotify(s.pos + glm::ivec2(0, 16), finished);
+            tryNotify(s.pos + glm::ivec2(0, -16), finished);
+        }
+        // Finishing a stage may unblock this Chunk or any of its neighbors
+        for(int dx = -16; dx <= 16; dx += 16) {
+            for(int dz = -16; dz <= 16; dz += 16) {
+                tryAdvance(toKey(s.pos.x + dx, s.pos.y + dz));
+            }
+        }
+    }
+
+    StageTiming &timing = m_timings[static_cast<int>(stage)];
+    timing.tasks++;
+    timing.nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+
+    // Outside m_lock, so the callbacks may take locks of their own in any
+    // order. m_notifying keeps removeZone from removing a Chunk in finished
+    // before whoever is notified has taken note of it. Only after this is
+    // the task done, so waitForIdle() cannot return before the callbacks run.
+    if(!finished.empty()) {
+        m_notifying++;
+        m_lock.unlock();
+        for(Chunk *c : finished) {
+            m_onChunkFinished(c);
+        }
+        m_lock.lock();
+        m_notifying--;
+    }
+    m_tasksInFlight--;
+    if(m_tasksInFlight == 0) {
+        m_idle.wakeAll();
+    }
+    m_lock.unlock();
+}
+
+void GenerationPipeline::tryAdvance(int64_t chunkKey) {
+    auto it = m_chunks.find(chunkKey);
+    if(it == m_chunks.end() || it->second.running || m_stopping) {
+        return;
+    }
+    ChunkState &state = it->second;
+    switch(state.stage) {
+    case GenStage::Terrain:
+    case GenStage::Carving:
+        break;
+    case GenStage::Decoration:
+    case GenStage::Light:
+        if(!neighborsReached(state.pos, state.stage)) {
+            return;
+        }
+        break;
+    default:
+        // Heightmap is run per zone, and Finished Chunks have nothing left to do
+        return;
+    }
+    state.running = true;
+    startTask(chunkKey, state.stage);
+}
+
+bool GenerationPipeline::neighborsReached(glm::ivec2 pos, GenStage stage) const {
+    for(int dx = -16; dx <= 16; dx += 16) {
+        for(int dz = -16; dz <= 16; dz += 16) {
+            auto it = m_chunks.find(toKey(pos.x + dx, pos.y + dz));
+            if(it == m_chunks.end() || it->second.stage < stage) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void GenerationPipeline::tryNotify(glm::ivec2 pos, std::vector<Chunk*> &finished) {
+    auto it = m_chunks.find(toKey(pos.x, pos.y));
+    if(it == m_chunks.end() || it->second.stage != GenStage::Finished || it->second.notified) {
+        return;
+    }
+    const glm::ivec2 edges[] = {{16, 0}, {-16, 0}, {0, 16}, {0, -16}};
+    for(const glm::ivec2 &d : edges) {
+        auto n = m_chunks.find(toKey(pos.x + d.x, pos.y + d.y));
+        if(n == m_chunks.end() || n->second.stage != GenStage::Finished) {
+            return;
+        }
+    }
+    it->second.notified = true;
+    finished.push_back(it->second.chunk);
+}
+
+void GenerationPipeline::startTask(int64_t key, GenStage stage) {
+    m_tasksInFlight++;
+    mp_pool->start(new StageWorker(this, key, stage));
+}
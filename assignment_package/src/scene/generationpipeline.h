@@ -0,0 +1,187 @@
+#pragma once
+#include "chunk.h"
+#include "zonemap.h"
+#include "decorator.h"
+#include "smartpointerhelp.h"
+#include <QMutex>
+#include <QThreadPool>
+#include <QWaitCondition>
+#include <array>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+// The stages every Chunk goes through, in order. Each stage of each
+// Chunk runs as its own task on a thread pool once its prerequisites
+// are met, so the stages of different Chunks overlap freely.
+enum class GenStage : unsigned char
+{
+    // The zone's ZoneMap. Computed once for all 16 Chunks of the zone.
+    Heightmap,
+    // Stone, biome layers and water (Chunk::fillTerrain)
+    Terrain,
+    // Caves and lava (Chunk::carveCaves)
+    Carving,
+    // Trees and ore veins (decorateChunk). Waits until all 8 neighbors
+    // are carved, so it never races their earlier stages. Blocks that
+    // spill into a neighbor are queued for that neighbor instead of
+    // being written into it.
+    Decoration,
+    // Waits until all 8 neighbors are decorated, then applies the blocks
+    // they queued for this Chunk and compacts its block storage. No other
+    // stage will touch this Chunk's blocks after that, so it is only
+    // meshed once.
+    Light,
+    // Every stage is done. The Chunk can be meshed once its 4 edge
+    // neighbors are Finished too, since meshing reads their border blocks.
+    Finished
+};
+
+static const int GEN_STAGE_COUNT = static_cast<int>(GenStage::Finished);
+
+const char* genStageName(GenStage stage);
+
+// Total time spent in one stage across every Chunk (or zone) so far
+struct StageTiming {
+    uint64_t tasks;
+    uint64_t nanoseconds;
+};
+
+// Schedules the generation stages of every Chunk handed to it. It only
+// knows about Chunks and ZoneMaps, not about Terrain or OpenGL, so it
+// can also run headless.
+class GenerationPipeline {
+public:
+    // Makes the EMPTY Chunk whose lower-left corner is pos, with its
+    // m_position set. Called on a worker.
+    typedef std::function<Chunk*(glm::ivec2)> ChunkFactory;
+    // Fills the Chunks it is given with blocks stored elsewhere, e.g. in
+    // a file, and returns the ones it filled. Called on a worker.
+    typedef std::function<std::vector<Chunk*>(const std::vector<Chunk*>&)> ZoneLoader;
+
+    // onChunkFinished is called from a worker thread whenever a Chunk
+    // can be meshed: it and its 4 edge neighbors have been through every
+    // stage. Before that a neighbor's Light stage may still be writing,
+    // and repacking, the very blocks the mesher would read.
+    // It is called after the pipeline's lock is released, so it may take
+    // other locks and call back into the pipeline. removeZone fails while
+    // any call is in progress, so the Chunk outlives the call.
+    GenerationPipeline(QThreadPool *pool, std::function<void(Chunk*)> onChunkFinished);
+    // Waits for every task that is already running, but starts no more
+    ~GenerationPipeline();
+
+    // Starts generating the 16 Chunks of the zone whose lower-left corner
+    // is zonePos. chunks must already exist, one per 16 x 16 area of the
+    // zone, and stay alive until the pipeline is destroyed.
+    void addZone(glm::ivec2 zonePos, const std::vector<Chunk*> &chunks);
+    // Like addZone, but the Chunks are made by makeChunk once the zone's
+    // Heightmap stage runs, so making them costs the caller nothing
+    void addZone(glm::ivec2 zonePos, ChunkFactory makeChunk);
+    // Like addZone, but for Chunks whose blocks are stored elsewhere.
+    // Instead of being generated they are filled in by load, which runs
+    // alongside the zone's ZoneMap. The Chunks it fills count as Finished.
+    // The rest are generated after all, so load must leave them EMPTY.
+    // The trees and veins a loaded Chunk would spill into a neighbor that
+    // is generated are found by generating and decorating it once more,
+    // and queued as if it had just been decorated.
+    void addLoadedZone(glm::ivec2 zonePos, ChunkFactory makeChunk, ZoneLoader load);
+    // Forgets the zone whose lower-left corner is zonePos, so its Chunks
+    // may be destroyed and the zone added again later. Returns false, and
+    // changes nothing, while a task for any of its Chunks is queued or
+    // running, or onChunkFinished is being called. Neighboring Chunks that
+    // were meshable become meshable again, with onChunkFinished called
+    // anew, once the zone is back. Frees the zone's ZoneMap, and the
+    // decoration writes no Chunk that may come back will need.
+    bool removeZone(glm::ivec2 zonePos);
+
+    // Whether the Chunk whose lower-left corner is chunkPos is Finished
+    bool isFinished(glm::ivec2 chunkPos) const;
+    // Whether onChunkFinished has been called for that Chunk
+    bool isMeshable(glm::ivec2 chunkPos) const;
+    // The ZoneMap of the zone whose lower-left corner is zonePos,
+    // or nullptr if its Heightmap stage has not run yet
+    const ZoneMap* zoneMapAt(glm::ivec2 zonePos) const;
+    std::array<StageTiming, GEN_STAGE_COUNT> stageTimings() const;
+    // How many blocks decoration has queued for neighboring Chunks so far
+    uint64_t deferredWrites() const;
+    // Bytes of the ZoneMaps and queued decoration writes held right now,
+    // and of the blocks of every Chunk as its last stage left them
+    size_t memoryBytes() const;
+
+    // Blocks until no task is queued or running. Chunks whose neighbors
+    // were never added stay stuck before Decoration.
+    void waitForIdle();
+
+    // Runs one stage for the zone or Chunk identified by key.
+    // Called by StageWorker.
+    void runTask(int64_t key, GenStage stage);
+
+private:
+    struct ChunkState {
+        // nullptr until the zone's Heightmap stage makes it,
+        // if it was added with a ChunkFactory
+        Chunk *chunk;
+        glm::ivec2 pos;
+        // The next stage this Chunk needs
+        GenStage stage;
+        // Whether a task for that stage is queued or running
+        bool running;
+        // Whether onChunkFinished has been called for it
+        bool notified;
+        // Its blockBytes() when its last stage was done
+        size_t bytes;
+    };
+
+    QThreadPool *mp_pool;
+    std::function<void(Chunk*)> m_onChunkFinished;
+
+    // Everything below is guarded by m_lock
+    mutable QMutex m_lock;
+    QWaitCondition m_idle;
+    std::unordered_map<int64_t, ChunkState> m_chunks;
+    std::unordered_map<int64_t, uPtr<ZoneMap>> m_zoneMaps;
+    // The blocks one Chunk's decoration queued for another
+    struct QueuedWrites {
+        int64_t origin;
+        std::vector<BlockWrite> writes;
+    };
+    // Blocks queued by decoration for the Chunk with each key, which
+    // that Chunk applies in its Light stage. May hold writes for
+    // Chunks that have not been added yet. They are kept after that,
+    // since a removed Chunk that is generated again needs them too,
+    // and a neighbor decorated or loaded again replaces its own. Only
+    // once both Chunks are removed are they dropped.
+    std::unordered_map<int64_t, std::vector<QueuedWrites>> m_pendingWrites;
+    // The factories and load functions of zones whose Chunks are made,
+    // or loaded, by their Heightmap stage, which has not run yet
+    std::unordered_map<int64_t, ChunkFactory> m_chunkFactories;
+    std::unordered_map<int64_t, ZoneLoader> m_loadedZones;
+    uint64_t m_deferredWrites;
+    // Blocks in m_pendingWrites
+    size_t m_queuedWrites;
+    // The sum of every ChunkState::bytes
+    size_t m_chunkBytes;
+    // Tasks calling onChunkFinished outside the lock
+    int m_notifying;
+    std::array<StageTiming, GEN_STAGE_COUNT> m_timings;
+    int m_tasksInFlight;
+    bool m_stopping;
+
+    // Queues a task for the stage chunkKey needs next if it can run now.
+    // Must be called with m_lock held.
+    void tryAdvance(int64_t chunkKey);
+    // Whether all 8 neighbors of pos exist and have reached stage
+    bool neighborsReached(glm::ivec2 pos, GenStage stage) const;
+    // Adds the Chunk at pos to finished if it has just become meshable.
+    // Must be called with m_lock held.
+    void tryNotify(glm::ivec2 pos, std::vector<Chunk*> &finished);
+    void addChunks(glm::ivec2 zonePos, const std::vector<Chunk*> &chunks);
+    // Drops the writes queued between Chunks around the zone at zonePos
+    // that have both been removed. Must be called with m_lock held.
+    void dropDeadWrites(glm::ivec2 zonePos);
+    // Queues the blocks decorating the Chunk with key origin spilled into
+    // its neighbors, replacing any it queued before.
+    // Must be called with m_lock held.
+    void queueSpilledWrites(int64_t origin, SpilledWrites &spilled);
+    void startTask(int64_t key, GenStage stage);
+};
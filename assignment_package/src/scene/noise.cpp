@@ -0,0 +1,169 @@
+#include "noise.h"
+#include "terrainnoise.h"
+#include <cmath>
+
+using noisegraph::evaluate;
+
+static NoiseBackend g_noiseBackend = {NoiseHash::Integer, 0};
+
+const NoiseBackend& noiseBackend() {
+    return g_noiseBackend;
+}
+
+void setNoiseBackend(NoiseBackend backend) {
+    g_noiseBackend = backend;
+}
+
+// The primes and rounds of xxHash32, applied to each coordinate in turn
+static const uint32_t PRIME32_2 = 0x85EBCA77u;
+static const uint32_t PRIME32_3 = 0xC2B2AE3Du;
+static const uint32_t PRIME32_4 = 0x27D4EB2Fu;
+static const uint32_t PRIME32_5 = 0x165667B1u;
+
+static inline uint32_t hashRound(uint32_t h, int32_t v) {
+    h += static_cast<uint32_t>(v) * PRIME32_3;
+    return ((h << 17) | (h >> 15)) * PRIME32_4;
+}
+
+static inline uint32_t hashAvalanche(uint32_t h) {
+    h ^= h >> 15;
+    h *= PRIME32_2;
+    h ^= h >> 13;
+    h *= PRIME32_3;
+    h ^= h >> 16;
+    return h;
+}
+
+uint32_t hashCoords(int32_t x, int32_t y, uint32_t seed) {
+    return hashAvalanche(hashRound(hashRound(seed + PRIME32_5, x), y));
+}
+
+uint32_t hashCoords(int32_t x, int32_t y, int32_t z, uint32_t seed) {
+    return hashAvalanche(hashRound(hashRound(hashRound(seed + PRIME32_5, x), y), z));
+}
+
+float hashToUnit(uint32_t h) {
+    return (h >> 8) * (1.f / 16777216.f);
+}
+
+// The terrain functions evaluate the graphs of terrainnoise.h
+float interpolate(glm::vec2 uv){
+    return evaluate(terrainnoise::BIOME_WEIGHT, uv.x, uv.y);
+}
+
+// p is always a lattice point, so its coordinates are whole numbers
+float noise2D(glm::vec2 p ) {
+    const NoiseBackend &backend = noiseBackend();
+    if(backend.hash == NoiseHash::Integer) {
+        return hashToUnit(hashCoords(static_cast<int32_t>(p.x), static_cast<int32_t>(p.y), backend.seed));
+    }
+    return glm::fract(sin(glm::dot(p, glm::vec2(127.1, 311.7))) *
+                 43758.5453);
+}
+float grass(glm::vec2 pos){
+    return evaluate(terrainnoise::GRASS, pos.x, pos.y);
+}
+float mountain(glm::vec2 pos){
+    return evaluate(terrainnoise::MOUNTAIN, pos.x, pos.y);
+}
+
+float fbm(float x, float y) {
+    return evaluate(terrainnoise::GRASS_OCTAVES, x, y);
+}
+float interpNoise2D(float x, float y) {
+    double intX,intY;
+    float fractX = modf(x,&intX);
+    float fractY = modf(y,&intY);
+
+    float v1 = noise2D(glm::vec2(intX, intY));
+    float v2 = noise2D(glm::vec2(intX+1, intY));
+    float v3 = noise2D(glm::vec2(intX, intY+1));
+    float v4 = noise2D(glm::vec2(intX+1, intY+1));
+
+    float i1 = LERP(v1, v2, fractX);
+    float i2 = LERP(v3, v4, fractX);
+    return LERP(i1, i2, fractY);
+}
+float LERP(float x,float y, float fract){
+    return (1-fract)*x+fract*y;
+}
+
+float Height(float worldx,float worldz){
+    return evaluate(terrainnoise::HEIGHT, worldx, worldz);
+}
+
+float Moisture(float worldx,float worldz){
+    return evaluate(terrainnoise::MOISTURE, worldx, worldz);
+}
+
+glm::vec2 random2( glm::vec2 p ) {
+    const NoiseBackend &backend = noiseBackend();
+    if(backend.hash == NoiseHash::Integer) {
+        int32_t x = static_cast<int32_t>(p.x);
+        int32_t y = static_cast<int32_t>(p.y);
+        return glm::vec2(hashToUnit(hashCoords(x, y, backend.seed)),
+                         hashToUnit(hashCoords(x, y, backend.seed + 1)));
+    }
+    return glm::fract(glm::sin(glm::vec2(glm::dot(p, glm::vec2(127.1, 311.7)),
+                 glm::dot(p, glm::vec2(269.5,183.3))))
+                 * 43758.5453f);
+}
+float WorleyNoise(glm::vec2 uv) {
+    uv *= 10.0; // Now the space is 10x10 instead of 1x1. Change this to any number you want.
+    glm::vec2 uvInt = glm::floor(uv);
+    glm::vec2 uvFract = glm::fract(uv);
+    float minDist = 1.0; // Minimum distance initialized to max.
+    for(int y = -1; y <= 1; ++y) {
+        for(int x = -1; x <= 1; ++x) {
+            glm::vec2 neighbor = glm::vec2(float(x), float(y)); // Direction in which neighbor cell lies
+            glm::vec2 point = random2(uvInt + neighbor); // Get the Voronoi centerpoint for the neighboring cell
+            glm::vec2 diff = neighbor + point - uvFract; // Distance between fragment coord and neighbor’s Voronoi point
+            float dist = glm::length(diff);
+            minDist = glm::min(minDist, dist);
+        }
+    }
+    return minDist;
+}
+
+float perlinNoise3D(glm::vec3 p) {
+    float surfletSum = 0.f;
+    // Iterate over the 8 integer corners surrounding uv
+    for(int dx = 0; dx <= 1; ++dx) {
+        for(int dy = 0; dy <= 1; ++dy) {
+            for(int dz = 0; dz <= 1; ++dz) {
+                surfletSum += surflet3D(p, glm::floor(p) + glm::vec3(dx, dy, dz));
+            }
+        }
+    }
+    return surfletSum;
+}
+float random3f(glm::vec3 p){
+    const NoiseBackend &backend = noiseBackend();
+    if(backend.hash == NoiseHash::Integer) {
+        return hashToUnit(hashCoords(static_cast<int32_t>(p.x), static_cast<int32_t>(p.y),
+                                     static_cast<int32_t>(p.z), backend.seed));
+    }
+    return glm::fract(sin(glm::dot(p, glm::vec3(127.1, 311.7,212.2))) *
+     43758.5453);
+}
+
+glm::vec3 random3(glm::vec3 i){
+    return glm::vec3(random3f(i),random3f(glm::vec3(i[1],i[2],i[0])),random3f(glm::vec3(i[2],i[0],i[1])));
+}
+
+float surflet3D(glm::vec3 p, glm::vec3 gridPoint) {
+ // Compute the distance between p and the grid point along each axis, and warp it with a
+ // quintic function so we can smooth our cells
+     glm::vec3 t2 = glm::abs(p - gridPoint);
+     // 1 - 6t^5 + 15t^4 - 10t^3, in Horner form rather than nine pow() calls
+     glm::vec3 t = glm::vec3(1.f) - t2 * t2 * t2 * (t2 * (t2 * 6.f - 15.f) + 10.f);
+     // Get the random vector for the grid point (assume we wrote a function random2
+     // that returns a vec2 in the range [0, 1])
+     glm::vec3 gradient = random3(gridPoint) * 2.f - glm::vec3(1.f, 1.f, 1.f);
+     // Get the vector from the grid point to P
+     glm::vec3 diff = p - gridPoint;
+     // Get the value of our height field by dotting grid->P with our gradient
+     float height = glm::dot(diff, gradient);
+     // Scale our height field (i.e. reduce it) by our polynomial falloff function
+     return height * t.x * t.y * t.z;
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include "glm_includes.h"
+#include <cstdint>
+
+// The hash functions that turn lattice points into pseudo-random values
+// for noise2D, random2 and random3f (and so for fbm, WorleyNoise and
+// perlinNoise3D, which are built on top of them).
+enum class NoiseHash : unsigned char
+{
+    // The classic fract(sin(dot(p, k)) * 43758.5453). It has no seed, and
+    // since sin() loses precision on large arguments, it degrades far from
+    // the origin and may differ between C libraries.
+    SinFract,
+    // xxHash32-style mixing of the integer lattice coordinates and a seed.
+    // Pure integer arithmetic, so every thread and platform gets the same
+    // values at any distance from the origin.
+    Integer
+};
+
+struct NoiseBackend {
+    NoiseHash hash;
+    uint32_t seed;
+};
+
+// The backend used by all of the noise functions below.
+// Defaults to NoiseHash::Integer with seed 0.
+const NoiseBackend& noiseBackend();
+// Workers read the backend without locking, so only change it
+// before any terrain has been generated.
+void setNoiseBackend(NoiseBackend backend);
+
+// Integer hashes of 2D and 3D lattice coordinates
+uint32_t hashCoords(int32_t x, int32_t y, uint32_t seed);
+uint32_t hashCoords(int32_t x, int32_t y, int32_t z, uint32_t seed);
+// Maps a hash to a float in [0, 1) using its top 24 bits,
+// all of which a float can represent exactly
+float hashToUnit(uint32_t h);
+
+// The noise functions that shape our terrain. Each of these evaluates
+// a single point (usually one x-z column of a Chunk) at a time.
+float noise2D(glm::vec2 p);
+glm::vec2 random2(glm::vec2 p);
+float random3f(glm::vec3 p);
+glm::vec3 random3(glm::vec3 i);
+float LERP(float x, float y, float fract);
+float interpNoise2D(float x, float y);
+float fbm(float x, float y);
+float WorleyNoise(glm::vec2 uv);
+float surflet3D(glm::vec3 p, glm::vec3 gridPoint);
+float perlinNoise3D(glm::vec3 p);
+
+// Terrain shape built out of the noise functions above,
+// as defined by the noise graphs of terrainnoise.h
+float mountain(glm::vec2 pos);
+float grass(glm::vec2 pos);
+float interpolate(glm::vec2 uv);
+float Height(float worldx, float worldz);
+float Moisture(float worldx, float worldz);
+
+// Instruction sets the batched column kernel can run on.
+// Scalar simply loops over Height() and Moisture().
+enum class SimdLevel : unsigned char
+{
+    Scalar, SSE2, AVX2
+};
+
+// The widest SimdLevel supported by both this build and the CPU we are running on
+SimdLevel bestSimdLevel();
+const char* simdLevelName(SimdLevel level);
+
+// Evaluates Height() and Moisture() for count columns at once.
+// The columns are given in structure-of-arrays form, so worldX[i] and
+// worldZ[i] describe the i-th column, whose results are written to
+// outHeight[i] and outMoisture[i]. The SIMD paths mirror the scalar
+// functions' float rounding step by step, so with NoiseHash::Integer
+// their results are identical to the scalar ones, and with
+// NoiseHash::SinFract they match up to the last bit or two of sin().
+void batchColumnNoise(const float *worldX, const float *worldZ,
+                      float *outHeight, float *outMoisture, int count,
+                      SimdLevel level = bestSimdLevel());
+// Convenience wrapper that evaluates the sizeX x sizeZ grid of columns whose
+// lower-left corner is origin (e.g. one 16 x 16 Chunk or one 64 x 64 zone).
+// Results are stored x-major: out[x + sizeX * z].
+void batchColumnNoiseGrid(glm::ivec2 origin, int sizeX, int sizeZ,
+                          float *outHeight, float *outMoisture,
+                          SimdLevel level = bestSimdLevel());
@@ -0,0 +1,236 @@
+#include "noise.h"
+#include "terrainnoise.h"
+#include <cmath>
+#include <vector>
+
+// Batched versions of Height() and Moisture(). The kernel itself lives in
+// noisekernel.inl and is compiled once for every instruction set we support,
+// each copy in its own namespace with its own lane primitives. Which copy
+// runs is decided at runtime by bestSimdLevel().
+
+#if defined(__x86_64__) || defined(_M_X64) || (defined(__i386__) && defined(__SSE2__))
+#define NOISE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+// GCC and Clang let us compile the AVX2 copy without building the whole
+// program with -mavx2, so the same binary still runs on older CPUs.
+#if defined(NOISE_SSE2) && (defined(__GNUC__) || defined(__clang__))
+#define NOISE_AVX2 1
+#include <immintrin.h>
+#endif
+
+#ifdef NOISE_SSE2
+namespace sse2 {
+namespace {
+
+struct vd { __m128d v; };
+struct vm { __m128d v; };
+constexpr int kLanes = 2;
+
+inline vd splat(double d) { return {_mm_set1_pd(d)}; }
+inline vd loadf(const float *p) {
+    return {_mm_cvtps_pd(_mm_castsi128_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p))))};
+}
+inline void storef(float *p, vd a) {
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(p), _mm_castps_si128(_mm_cvtpd_ps(a.v)));
+}
+
+inline vd operator+(vd a, vd b) { return {_mm_add_pd(a.v, b.v)}; }
+inline vd operator-(vd a, vd b) { return {_mm_sub_pd(a.v, b.v)}; }
+inline vd operator*(vd a, vd b) { return {_mm_mul_pd(a.v, b.v)}; }
+inline vd operator/(vd a, vd b) { return {_mm_div_pd(a.v, b.v)}; }
+inline vm operator<(vd a, vd b) { return {_mm_cmplt_pd(a.v, b.v)}; }
+inline vm operator>(vd a, vd b) { return {_mm_cmpgt_pd(a.v, b.v)}; }
+inline vm operator^(vm a, vm b) { return {_mm_xor_pd(a.v, b.v)}; }
+
+inline vd vmin(vd a, vd b) { return {_mm_min_pd(a.v, b.v)}; }
+inline vd vmax(vd a, vd b) { return {_mm_max_pd(a.v, b.v)}; }
+inline vd vsqrt(vd a) { return {_mm_sqrt_pd(a.v)}; }
+inline vd vabs(vd a) { return {_mm_andnot_pd(_mm_set1_pd(-0.0), a.v)}; }
+inline vd select(vm m, vd a, vd b) {
+    return {_mm_or_pd(_mm_and_pd(m.v, a.v), _mm_andnot_pd(m.v, b.v))};
+}
+// SSE2 has no packed rounding instruction. Adding and subtracting 1.5 * 2^52
+// rounds to the nearest integer, which is much cheaper than a round trip
+// through int32. Every value we round here is far smaller than 2^31.
+inline vd vround(vd a) {
+    const __m128d magic = _mm_set1_pd(6755399441055744.0);
+    return {_mm_sub_pd(_mm_add_pd(a.v, magic), magic)};
+}
+inline vd vfloor(vd a) {
+    const vd r = vround(a);
+    return {_mm_sub_pd(r.v, _mm_and_pd(_mm_cmpgt_pd(r.v, a.v), _mm_set1_pd(1.0)))};
+}
+inline vd vtrunc(vd a) { return {_mm_cvtepi32_pd(_mm_cvttpd_epi32(a.v))}; }
+inline vm bitSet(vd n, int bit) {
+    const __m128i b = _mm_set1_epi32(1 << bit);
+    // Spread the two int32 results so each one fills a 64-bit lane
+    const __m128i i = _mm_shuffle_epi32(_mm_cvtpd_epi32(n.v), _MM_SHUFFLE(1, 1, 0, 0));
+    return {_mm_castsi128_pd(_mm_cmpeq_epi32(_mm_and_si128(i, b), b))};
+}
+inline vd fl(vd a) { return {_mm_cvtps_pd(_mm_cvtpd_ps(a.v))}; }
+
+// Only the low two of the four int32 lanes are used
+struct vi { __m128i v; };
+inline vi isplat(uint32_t u) { return {_mm_set1_epi32(static_cast<int>(u))}; }
+inline vi toInt(vd a) { return {_mm_cvtpd_epi32(a.v)}; }
+inline vi operator+(vi a, vi b) { return {_mm_add_epi32(a.v, b.v)}; }
+inline vi operator^(vi a, vi b) { return {_mm_xor_si128(a.v, b.v)}; }
+inline vi operator|(vi a, vi b) { return {_mm_or_si128(a.v, b.v)}; }
+inline vi operator<<(vi a, int n) { return {_mm_sll_epi32(a.v, _mm_cvtsi32_si128(n))}; }
+inline vi operator>>(vi a, int n) { return {_mm_srl_epi32(a.v, _mm_cvtsi32_si128(n))}; }
+// SSE2 only multiplies the even lanes into 64-bit products, so do the
+// even and odd lanes separately and gather the low halves back together
+inline vi operator*(vi a, uint32_t k) {
+    const __m128i b = _mm_set1_epi32(static_cast<int>(k));
+    const __m128i even = _mm_mul_epu32(a.v, b);
+    const __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a.v, 32), b);
+    return {_mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                               _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)))};
+}
+inline vd unitFromHash(vi h) {
+    return {_mm_mul_pd(_mm_cvtepi32_pd(_mm_srli_epi32(h.v, 8)), _mm_set1_pd(1.0 / 16777216.0))};
+}
+
+#include "noisekernel.inl"
+
+} // namespace
+} // namespace sse2
+#endif // NOISE_SSE2
+
+#ifdef NOISE_AVX2
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx2"))), apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#endif
+namespace avx2 {
+namespace {
+
+struct vd { __m256d v; };
+struct vm { __m256d v; };
+constexpr int kLanes = 4;
+
+inline vd splat(double d) { return {_mm256_set1_pd(d)}; }
+inline vd loadf(const float *p) { return {_mm256_cvtps_pd(_mm_loadu_ps(p))}; }
+inline void storef(float *p, vd a) { _mm_storeu_ps(p, _mm256_cvtpd_ps(a.v)); }
+
+inline vd operator+(vd a, vd b) { return {_mm256_add_pd(a.v, b.v)}; }
+inline vd operator-(vd a, vd b) { return {_mm256_sub_pd(a.v, b.v)}; }
+inline vd operator*(vd a, vd b) { return {_mm256_mul_pd(a.v, b.v)}; }
+inline vd operator/(vd a, vd b) { return {_mm256_div_pd(a.v, b.v)}; }
+inline vm operator<(vd a, vd b) { return {_mm256_cmp_pd(a.v, b.v, _CMP_LT_OQ)}; }
+inline vm operator>(vd a, vd b) { return {_mm256_cmp_pd(a.v, b.v, _CMP_GT_OQ)}; }
+inline vm operator^(vm a, vm b) { return {_mm256_xor_pd(a.v, b.v)}; }
+
+inline vd vmin(vd a, vd b) { return {_mm256_min_pd(a.v, b.v)}; }
+inline vd vmax(vd a, vd b) { return {_mm256_max_pd(a.v, b.v)}; }
+inline vd vsqrt(vd a) { return {_mm256_sqrt_pd(a.v)}; }
+inline vd vabs(vd a) { return {_mm256_andnot_pd(_mm256_set1_pd(-0.0), a.v)}; }
+inline vd select(vm m, vd a, vd b) { return {_mm256_blendv_pd(b.v, a.v, m.v)}; }
+inline vd vtrunc(vd a) { return {_mm256_round_pd(a.v, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC)}; }
+inline vd vround(vd a) { return {_mm256_round_pd(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC)}; }
+inline vd vfloor(vd a) { return {_mm256_floor_pd(a.v)}; }
+inline vm bitSet(vd n, int bit) {
+    const __m256i b = _mm256_set1_epi64x(1 << bit);
+    const __m256i i = _mm256_cvtepi32_epi64(_mm256_cvtpd_epi32(n.v));
+    return {_mm256_castsi256_pd(_mm256_cmpeq_epi64(_mm256_and_si256(i, b), b))};
+}
+inline vd fl(vd a) { return {_mm256_cvtps_pd(_mm256_cvtpd_ps(a.v))}; }
+
+// Four lanes of int32 fit in a single SSE register
+struct vi { __m128i v; };
+inline vi isplat(uint32_t u) { return {_mm_set1_epi32(static_cast<int>(u))}; }
+inline vi toInt(vd a) { return {_mm256_cvtpd_epi32(a.v)}; }
+inline vi operator+(vi a, vi b) { return {_mm_add_epi32(a.v, b.v)}; }
+inline vi operator^(vi a, vi b) { return {_mm_xor_si128(a.v, b.v)}; }
+inline vi operator|(vi a, vi b) { return {_mm_or_si128(a.v, b.v)}; }
+inline vi operator<<(vi a, int n) { return {_mm_sll_epi32(a.v, _mm_cvtsi32_si128(n))}; }
+inline vi operator>>(vi a, int n) { return {_mm_srl_epi32(a.v, _mm_cvtsi32_si128(n))}; }
+inline vi operator*(vi a, uint32_t k) { return {_mm_mullo_epi32(a.v, _mm_set1_epi32(static_cast<int>(k)))}; }
+inline vd unitFromHash(vi h) {
+    return {_mm256_mul_pd(_mm256_cvtepi32_pd(_mm_srli_epi32(h.v, 8)), _mm256_set1_pd(1.0 / 16777216.0))};
+}
+
+#include "noisekernel.inl"
+
+} // namespace
+} // namespace avx2
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+#endif // NOISE_AVX2
+
+static SimdLevel detectSimdLevel() {
+#if defined(NOISE_AVX2)
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")) {
+        return SimdLevel::AVX2;
+    }
+#endif
+#if defined(NOISE_SSE2)
+    return SimdLevel::SSE2;
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+SimdLevel bestSimdLevel() {
+    static const SimdLevel level = detectSimdLevel();
+    return level;
+}
+
+const char* simdLevelName(SimdLevel level) {
+    switch(level) {
+    case SimdLevel::AVX2:
+        return "AVX2";
+    case SimdLevel::SSE2:
+        return "SSE2";
+    default:
+        return "scalar";
+    }
+}
+
+void batchColumnNoise(const float *worldX, const float *worldZ,
+                      float *outHeight, float *outMoisture, int count,
+                      SimdLevel level) {
+    // Never run a path this CPU (or this build) cannot execute
+    if(level > bestSimdLevel()) {
+        level = bestSimdLevel();
+    }
+    switch(level) {
+#ifdef NOISE_AVX2
+    case SimdLevel::AVX2:
+        avx2::columnNoise(worldX, worldZ, outHeight, outMoisture, count, noiseBackend());
+        break;
+#endif
+#ifdef NOISE_SSE2
+    case SimdLevel::SSE2:
+        sse2::columnNoise(worldX, worldZ, outHeight, outMoisture, count, noiseBackend());
+        break;
+#endif
+    default:
+        for(int i = 0; i < count; i++) {
+            outHeight[i] = Height(worldX[i], worldZ[i]);
+            outMoisture[i] = Moisture(worldX[i], worldZ[i]);
+        }
+        break;
+    }
+}
+
+void batchColumnNoiseGrid(glm::ivec2 origin, int sizeX, int sizeZ,
+                          float *outHeight, float *outMoisture,
+                          SimdLevel level) {
+    std::vector<float> worldX(sizeX * sizeZ), worldZ(sizeX * sizeZ);
+    for(int z = 0; z < sizeZ; z++) {
+        for(int x = 0; x < sizeX; x++) {
+            worldX[x + sizeX * z] = origin.x + x;
+            worldZ[x + sizeX * z] = origin.y + z;
+        }
+    }
+    batchColumnNoise(worldX.data(), worldZ.data(), outHeight, outMoisture, sizeX * sizeZ, level);
+}
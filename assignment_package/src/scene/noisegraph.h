@@ -0,0 +1,252 @@
+#pragma once
+#include "noise.h"
+#include <cmath>
+
+// A small expression library for building terrain noise out of nodes.
+// Each node is a plain struct that holds its children and constants, so a
+// whole graph is a single nested type. There are no virtual calls: the
+// compiler sees the full expression and inlines it into whatever evaluates
+// it. See terrainnoise.h for the graphs that shape our terrain.
+//
+// A node is called as node(lanes, x, z) and returns its value at the point
+// (x, z). The lanes object supplies the arithmetic and the noise functions
+// for one evaluation mode, and V is its value type:
+//   ScalarLanes below evaluates a single column in float.
+//   The ColumnKernel in noisekernel.inl evaluates a batch of columns in
+//   SIMD lanes, rounding like ScalarLanes so both give identical results.
+// A lanes type provides
+//   constant(float)                  a V holding the constant
+//   add, sub, mul, div (V, V)        float arithmetic
+//   lerp(a, b, t)                    LERP(a, b, t)
+//   clamp(v, lo, hi)                 glm::clamp
+//   smoothStep(edge0, edge1, v)      glm::smoothstep
+//   abs(V), cos(V)
+//   valueNoise(x, z)                 interpNoise2D
+//   worley(x, z)                     WorleyNoise
+
+// Every node is forced inline. Besides making sure the whole graph is
+// flattened, this lets noisebatch.cpp evaluate graphs inside its AVX2
+// functions: an out-of-line node compiled without AVX2 could not take
+// or return 256-bit lanes. Nodes take their points by const reference,
+// since GCC notes an ABI change for 32-byte lanes passed by value.
+#if defined(__GNUC__) || defined(__clang__)
+#define NOISEGRAPH_INLINE inline __attribute__((always_inline))
+#elif defined(_MSC_VER)
+#define NOISEGRAPH_INLINE __forceinline
+#else
+#define NOISEGRAPH_INLINE inline
+#endif
+
+namespace noisegraph {
+
+// Evaluates a single column with the scalar noise functions of noise.cpp
+struct ScalarLanes {
+    typedef float V;
+
+    V constant(float c) const { return c; }
+    V add(V a, V b) const { return a + b; }
+    V sub(V a, V b) const { return a - b; }
+    V mul(V a, V b) const { return a * b; }
+    V div(V a, V b) const { return a / b; }
+    V lerp(V a, V b, V t) const { return LERP(a, b, t); }
+    V clamp(V v, float lo, float hi) const { return glm::clamp(v, lo, hi); }
+    V smoothStep(float edge0, float edge1, V v) const { return glm::smoothstep(edge0, edge1, v); }
+    V abs(V v) const { return std::abs(v); }
+    // The double-precision cos, as the terrain functions always used
+    V cos(V v) const { return static_cast<float>(std::cos(static_cast<double>(v))); }
+    V valueNoise(V x, V z) const { return interpNoise2D(x, z); }
+    V worley(V x, V z) const { return WorleyNoise(glm::vec2(x, z)); }
+};
+
+// Leaves
+
+// The x coordinate of the point, e.g. the value passed through map()
+struct X {
+    template <typename L, typename V>
+    NOISEGRAPH_INLINE V operator()(const L&, const V &x, const V&) const { return x; }
+};
+
+// interpNoise2D, bilinear value noise on the integer lattice
+struct ValueNoise {
+    template <typename L, typename V>
+    NOISEGRAPH_INLINE V operator()(const L &l, const V &x, const V &z) const { return l.valueNoise(x, z); }
+};
+
+// WorleyNoise, the distance to the nearest of one random point per 0.1 x 0.1 cell
+struct Worley {
+    template <typename L, typename V>
+    NOISEGRAPH_INLINE V operator()(const L &l, const V &x, const V &z) const { return l.worley(x, z); }
+};
+
+// Domain transforms, which change the point their child is evaluated at
+
+// child(x / divisor, z / divisor)
+template <typename Child>
+struct Scale {
+    Child child;
+    float divisor;
+
+    template <typename L, typename V>
+    NOISEGRAPH_INLINE V operator()(const L &l, const V &x, const V &z) const {
+        const V d = l.constant(divisor);
+        return child(l, l.div(x, d), l.div(z, d));
+    }
+};
+
+// child(|x|, |z|)
+template <typename Child>
+struct AbsDomain {
+    Child child;
+
+    template <typename L, typename V>
+    NOISEGRAPH_INLINE V operator()(const L &l, const V &x, const V &z) const { return child(l, l.abs(x), l.abs(z)); }
+};
+
+// child(cos(x / divisor), cos(z / divisor)), which folds the whole world
+// into [-1, 1] x [-1, 1] and mirrors it every 2 pi * divisor blocks
+template <typename Child>
+struct CosWarp {
+    Child child;
+    float divisor;
+
+    template <typename L, typename V>
+    NOISEGRAPH_INLINE V operator()(const L &l, const V &x, const V &z) const {
+        const V d = l.constant(divisor);
+        return child(l, l.cos(l.div(x, d)), l.cos(l.div(z, d)));
+    }
+};
+
+// Value transforms
+
+// The sum of octaves first to last of child. Octave i samples child at
+// frequency * lacunarity^(i - 1) and scales it by amplitude * gain^(i - 1).
+template <typename Child>
+struct Octaves {
+    Child child;
+    int first, last;
+    float frequency, amplitude, lacunarity, gain;
+
+    template <typename L, typename V>
+    NOISEGRAPH_INLINE V operator()(const L &l, const V &x, const V &z) const {
+        V total = l.constant(0.f);
+        float freq = frequency;
+        float amp = amplitude;
+        for(int i = 1; i <= last; i++) {
+            if(i >= first) {
+                const V f = l.constant(freq);
+                total = l.add(total, l.mul(child(l, l.mul(x, f), l.mul(z, f)), l.constant(amp)));
+            }
+            freq *= lacunarity;
+            amp *= gain;
+        }
+        return total;
+    }
+};
+
+// child * mul + add
+template <typename Child>
+struct Affine {
+    Child child;
+    float mul, add;
+
+    template <typename L, typename V>
+    NOISEGRAPH_INLINE V operator()(const L &l, const V &x, const V &z) const {
+        return l.add(l.mul(child(l, x, z), l.constant(mul)), l.constant(add));
+    }
+};
+
+// Maps [0, 1] onto [lo, hi]
+template <typename Child>
+struct Remap {
+    Child child;
+    float lo, hi;
+
+    template <typename L, typename V>
+    NOISEGRAPH_INLINE V operator()(const L &l, const V &x, const V &z) const {
+        return l.lerp(l.constant(lo), l.constant(hi), child(l, x, z));
+    }
+};
+
+template <typename Child>
+struct Clamp {
+    Child child;
+    float lo, hi;
+
+    template <typename L, typename V>
+    NOISEGRAPH_INLINE V operator()(const L &l, const V &x, const V &z) const { return l.clamp(child(l, x, z), lo, hi); }
+};
+
+template <typename Child>
+struct SmoothStep {
+    Child child;
+    float edge0, edge1;
+
+    template <typename L, typename V>
+    NOISEGRAPH_INLINE V operator()(const L &l, const V &x, const V &z) const { return l.smoothStep(edge0, edge1, child(l, x, z)); }
+};
+
+// fn evaluated at (child, child), so fn's X() is child's value
+template <typename Child, typename Fn>
+struct Map {
+    Child child;
+    Fn fn;
+
+    template <typename L, typename V>
+    NOISEGRAPH_INLINE V operator()(const L &l, const V &x, const V &z) const {
+        const V v = child(l, x, z);
+        return fn(l, v, v);
+    }
+};
+
+// Blends from a to b by weight, which is evaluated at the point (a, b)
+template <typename A, typename B, typename Weight>
+struct Blend {
+    A a;
+    B b;
+    Weight weight;
+
+    template <typename L, typename V>
+    NOISEGRAPH_INLINE V operator()(const L &l, const V &x, const V &z) const {
+        const V va = a(l, x, z);
+        const V vb = b(l, x, z);
+        return l.lerp(va, vb, weight(l, va, vb));
+    }
+};
+
+// Builders, so graphs read from the outside in
+
+constexpr ValueNoise valueNoise() { return {}; }
+constexpr Worley worley() { return {}; }
+
+template <typename C>
+constexpr Scale<C> scale(C child, float divisor) { return {child, divisor}; }
+template <typename C>
+constexpr AbsDomain<C> absDomain(C child) { return {child}; }
+template <typename C>
+constexpr CosWarp<C> cosWarp(C child, float divisor) { return {child, divisor}; }
+
+template <typename C>
+constexpr Octaves<C> octaves(C child, int count, float frequency, float amplitude,
+                             float lacunarity = 2.f, float gain = 0.5f) {
+    return {child, 1, count, frequency, amplitude, lacunarity, gain};
+}
+template <typename C>
+constexpr Affine<C> affine(C child, float mul, float add) { return {child, mul, add}; }
+template <typename C>
+constexpr Remap<C> remap(C child, float lo, float hi) { return {child, lo, hi}; }
+template <typename C>
+constexpr Clamp<C> clamp(C child, float lo, float hi) { return {child, lo, hi}; }
+template <typename C>
+constexpr SmoothStep<C> smoothStep(C child, float edge0, float edge1) { return {child, edge0, edge1}; }
+template <typename C, typename F>
+constexpr Map<C, F> map(C child, F fn) { return {child, fn}; }
+template <typename A, typename B, typename W>
+constexpr Blend<A, B, W> blend(A a, B b, W weight) { return {a, b, weight}; }
+
+// Evaluates graph for a single column
+template <typename Graph>
+float evaluate(const Graph &graph, float x, float z) {
+    return graph(ScalarLanes(), x, z);
+}
+
+} // namespace noisegraph
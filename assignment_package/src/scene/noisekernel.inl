@@ -0,0 +1,242 @@
+// The batched column noise kernel, written once against a small set of
+// lane primitives and compiled once per instruction set by noisebatch.cpp.
+// Do not include this file anywhere else.
+//
+// Every lane holds a double. The scalar noise functions work in float
+// (apart from the sin() inside noise2D), so after each float operation we
+// round the lane back to float precision with fl(). A product of two floats
+// is exact in double, so rounding it once gives the same bits as the float
+// multiply would have. This keeps the SinFract hashes below bit-compatible
+// enough that fract(sin(x) * 43758.5453) lands on the same value as the
+// scalar path. The Integer hashes are exact by construction.
+//
+// The enclosing scope must provide:
+//   vd, vm, vi                     lane, lane-mask and 32-bit integer lane types
+//   kLanes                         number of lanes in vd
+//   splat, loadf, storef           broadcast / float load / float store
+//   + - * / < >                    lane arithmetic and comparisons
+//   ^                              exclusive or of two masks
+//   vmin, vmax, vsqrt, vabs        element-wise helpers
+//   vfloor, vtrunc, vround         rounding to an integer value
+//   bitSet(n, b)                   mask of lanes whose integer value n has bit b set
+//   select(m, a, b)                a where m is set, b elsewhere
+//   fl                             round each lane to float precision
+//   isplat, toInt                  broadcast / convert whole-number lanes to vi
+//   vi + ^ | << >>, vi * uint32_t  wrapping 32-bit integer arithmetic
+//   unitFromHash                   hashToUnit() of each vi lane
+
+inline vd fract(vd x) {
+    return x - vfloor(x);
+}
+
+inline vd vclamp(vd x, double lo, double hi) {
+    return vmin(vmax(x, splat(lo)), splat(hi));
+}
+
+// float LERP(x, y, t) = (1 - t) * x + t * y, one float rounding per operation
+inline vd lerpF(vd x, vd y, vd t) {
+    return fl(fl(fl(splat(1.0) - t) * x) + fl(t * y));
+}
+
+// sin and cos in double precision. We reduce x into [-pi/4, pi/4] with a
+// three-part pi/2 (exact for |x| < 2^20 * pi/2, far beyond any world
+// coordinate we hash) and use fdlibm's kernel polynomials.
+inline void sinCos(vd x, vd &outSin, vd &outCos) {
+    const vd n = vround(x * splat(6.36619772367581382433e-01));
+    vd r = x - n * splat(1.57079632673412561417e+00);
+    r = r - n * splat(6.07710050630396597660e-11);
+    r = r - n * splat(2.02226624871116645580e-21);
+
+    const vd z = r * r;
+    const vd s = r + r * z * (splat(-1.66666666666666324348e-01) + z * (splat(8.33333333332248946124e-03)
+                 + z * (splat(-1.98412698298579493134e-04) + z * (splat(2.75573137070700676789e-06)
+                 + z * (splat(-2.50507602534068634195e-08) + z * splat(1.58969099521155010221e-10))))));
+    const vd c = splat(1.0) - splat(0.5) * z + z * z * (splat(4.16666666666666019037e-02)
+                 + z * (splat(-1.38888888888741095749e-03) + z * (splat(2.48015872894767294178e-05)
+                 + z * (splat(-2.75573143513906633035e-07) + z * (splat(2.08757232129817482790e-09)
+                 + z * splat(-1.13596475577881948265e-11))))));
+
+    // The low two bits of n give the quadrant x lies in
+    const vm odd = bitSet(n, 0);
+    const vm negSin = bitSet(n, 1);
+    const vm negCos = odd ^ negSin;
+
+    const vd sinAbs = select(odd, c, s);
+    const vd cosAbs = select(odd, s, c);
+    outSin = select(negSin, splat(0.0) - sinAbs, sinAbs);
+    outCos = select(negCos, splat(0.0) - cosAbs, cosAbs);
+}
+
+inline vd vsin(vd x) {
+    vd s, c;
+    sinCos(x, s, c);
+    return s;
+}
+
+inline vd vcos(vd x) {
+    vd s, c;
+    sinCos(x, s, c);
+    return c;
+}
+
+// hashCoords(x, y, seed) of noise.cpp, one xxHash32 round per coordinate
+inline vi hashRound(vi h, vi v) {
+    h = h + v * 0xC2B2AE3Du;
+    return ((h << 17) | (h >> 15)) * 0x27D4EB2Fu;
+}
+
+inline vi hashCoords2(vi x, vi y, uint32_t seed) {
+    vi h = hashRound(hashRound(isplat(seed + 0x165667B1u), x), y);
+    h = h ^ (h >> 15);
+    h = h * 0x85EBCA77u;
+    h = h ^ (h >> 13);
+    h = h * 0xC2B2AE3Du;
+    return h ^ (h >> 16);
+}
+
+// The noise functions of noise.cpp, and the lane primitives that let the
+// terrain graphs of terrainnoise.h run on them. Hash picks the NoiseHash used
+// by noise2D and random2 at compile time, so neither copy pays for a branch.
+template <NoiseHash Hash>
+struct ColumnKernel {
+    uint32_t seed;
+
+    // noise2D(p) = fract(sin(dot(p, (127.1, 311.7))) * 43758.5453), with the
+    // dot product in float and the sin in double
+    vd noise2D(vd px, vd py) const {
+        if(Hash == NoiseHash::Integer) {
+            return unitFromHash(hashCoords2(toInt(px), toInt(py), seed));
+        }
+        const vd d = fl(fl(px * splat(double(127.1f))) + fl(py * splat(double(311.7f))));
+        return fl(fract(vsin(d) * splat(43758.5453)));
+    }
+
+    // random2(p), computed in float like glm::sin on a vec2
+    void random2(vd px, vd py, vd &outX, vd &outY) const {
+        if(Hash == NoiseHash::Integer) {
+            const vi x = toInt(px);
+            const vi y = toInt(py);
+            outX = unitFromHash(hashCoords2(x, y, seed));
+            outY = unitFromHash(hashCoords2(x, y, seed + 1));
+            return;
+        }
+        const vd a = fl(fl(px * splat(double(127.1f))) + fl(py * splat(double(311.7f))));
+        const vd b = fl(fl(px * splat(double(269.5f))) + fl(py * splat(double(183.3f))));
+        vd sa, sb, unused;
+        sinCos(a, sa, unused);
+        sinCos(b, sb, unused);
+        outX = fract(fl(fl(sa) * splat(double(43758.5453f))));
+        outY = fract(fl(fl(sb) * splat(double(43758.5453f))));
+    }
+
+    vd interpNoise2D(vd x, vd y) const {
+        const vd intX = vtrunc(x);
+        const vd intY = vtrunc(y);
+        const vd fractX = x - intX;
+        const vd fractY = y - intY;
+        const vd one = splat(1.0);
+
+        const vd v1 = noise2D(intX, intY);
+        const vd v2 = noise2D(intX + one, intY);
+        const vd v3 = noise2D(intX, intY + one);
+        const vd v4 = noise2D(intX + one, intY + one);
+
+        const vd i1 = lerpF(v1, v2, fractX);
+        const vd i2 = lerpF(v3, v4, fractX);
+        return lerpF(i1, i2, fractY);
+    }
+
+    vd worleyNoise(vd u, vd v) const {
+        u = fl(u * splat(10.0));
+        v = fl(v * splat(10.0));
+        const vd uInt = vfloor(u);
+        const vd vInt = vfloor(v);
+        // Exact for u >= 0, but -0.2 - (-1) needs rounding like glm::fract
+        const vd uFract = fl(u - uInt);
+        const vd vFract = fl(v - vInt);
+        vd minDist = splat(1.0);
+        for(int y = -1; y <= 1; ++y) {
+            for(int x = -1; x <= 1; ++x) {
+                const vd nx = splat(x);
+                const vd ny = splat(y);
+                vd pointX, pointY;
+                random2(uInt + nx, vInt + ny, pointX, pointY);
+                const vd diffX = fl(fl(nx + pointX) - uFract);
+                const vd diffY = fl(fl(ny + pointY) - vFract);
+                const vd dist = fl(vsqrt(fl(fl(diffX * diffX) + fl(diffY * diffY))));
+                minDist = vmin(minDist, dist);
+            }
+        }
+        return minDist;
+    }
+
+    // The lane primitives of noisegraph.h, rounding like ScalarLanes does
+    typedef vd V;
+
+    vd constant(float c) const { return splat(c); }
+    vd add(vd a, vd b) const { return fl(a + b); }
+    vd sub(vd a, vd b) const { return fl(a - b); }
+    vd mul(vd a, vd b) const { return fl(a * b); }
+    vd div(vd a, vd b) const { return fl(a / b); }
+    vd lerp(vd a, vd b, vd t) const { return lerpF(a, b, t); }
+    vd clamp(vd v, float lo, float hi) const { return vclamp(v, lo, hi); }
+    vd abs(vd v) const { return vabs(v); }
+    vd cos(vd v) const { return fl(vcos(v)); }
+    vd valueNoise(vd x, vd z) const { return interpNoise2D(x, z); }
+    vd worley(vd x, vd z) const { return worleyNoise(x, z); }
+
+    vd smoothStep(float edge0, float edge1, vd v) const {
+        const vd t = vclamp(fl(fl(v - splat(edge0)) / splat(edge1 - edge0)), 0.0, 1.0);
+        return fl(fl(t * t) * fl(splat(3.0) - fl(splat(2.0) * t)));
+    }
+
+    // Calls fn(x, z, i, n) for count columns, kLanes at a time, where the
+    // batch holds columns i to i + n - 1. A partial last batch is padded by
+    // repeating the final column.
+    template <typename Fn>
+    void forEachBatch(const float *worldX, const float *worldZ, int count, Fn fn) const {
+        for(int i = 0; i < count; i += kLanes) {
+            const int n = count - i < kLanes ? count - i : kLanes;
+            float x[kLanes], z[kLanes];
+            for(int l = 0; l < kLanes; l++) {
+                x[l] = worldX[i + (l < n ? l : n - 1)];
+                z[l] = worldZ[i + (l < n ? l : n - 1)];
+            }
+            fn(loadf(x), loadf(z), i, n);
+        }
+    }
+
+    static void store(float *out, int i, int n, vd v) {
+        float f[kLanes];
+        storef(f, v);
+        for(int l = 0; l < n; l++) {
+            out[i + l] = f[l];
+        }
+    }
+
+    void run(const float *worldX, const float *worldZ,
+             float *outHeight, float *outMoisture, int count) const {
+        forEachBatch(worldX, worldZ, count, [&](vd x, vd z, int i, int n) {
+            store(outHeight, i, n, terrainnoise::HEIGHT(*this, x, z));
+            store(outMoisture, i, n, terrainnoise::MOISTURE(*this, x, z));
+        });
+    }
+};
+
+// Calls fn with the ColumnKernel for backend
+template <typename Fn>
+void withKernel(const NoiseBackend &backend, Fn fn) {
+    if(backend.hash == NoiseHash::Integer) {
+        fn(ColumnKernel<NoiseHash::Integer>{backend.seed});
+    } else {
+        fn(ColumnKernel<NoiseHash::SinFract>{backend.seed});
+    }
+}
+
+void columnNoise(const float *worldX, const float *worldZ,
+                 float *outHeight, float *outMoisture, int count,
+                 const NoiseBackend &backend) {
+    withKernel(backend, [&](const auto &kernel) {
+        kernel.run(worldX, worldZ, outHeight, outMoisture, count);
+    });
+}
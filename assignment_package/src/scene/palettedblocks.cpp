@@ -0,0 +1,176 @@
+#include "palettedblocks.h"
+#include <algorithm>
+
+// The narrowest of 0, 1, 2, 4 and 8 bits that can index paletteSize entries
+static int bitsFor(size_t paletteSize) {
+    if(paletteSize <= 1) {
+        return 0;
+    }
+    int bits = 1;
+    while((size_t(1) << bits) < paletteSize) {
+        bits *= 2;
+    }
+    return bits;
+}
+
+PalettedBlocks::PalettedBlocks(int size, BlockType fill)
+    : m_size(size), m_bits(0), m_mask(0), m_palette{fill}, m_paletteSize(1), m_words()
+{}
+
+void PalettedBlocks::set(int i, BlockType t) {
+    const int index = paletteIndex(t);
+    if(m_bits > 0) {
+        setIndex(i, index);
+    }
+}
+
+void PalettedBlocks::fill(int start, int stride, int count, BlockType t) {
+    const uint64_t index = paletteIndex(t);
+    if(m_bits == 0) {
+        return;
+    }
+    // Local copies, since the compiler must otherwise assume
+    // every write to m_words could change m_mask
+    const int bits = m_bits;
+    const uint64_t mask = m_mask;
+    uint64_t *words = m_words.data();
+    for(int i = 0, bit = start * bits; i < count; i++, bit += stride * bits) {
+        uint64_t &word = words[bit >> 6];
+        word = (word & ~(mask << (bit & 63))) | (index << (bit & 63));
+    }
+}
+
+void PalettedBlocks::replace(int start, int stride, int count, BlockType from, BlockType to) {
+    int fromIndex = -1;
+    for(int p = 0; p < m_paletteSize; p++) {
+        if(m_palette[p] == from) {
+            fromIndex = p;
+        }
+    }
+    if(fromIndex < 0) {
+        return;
+    }
+    const uint64_t toIndex = paletteIndex(to);
+    if(m_bits == 0) {
+        return;
+    }
+    for(int i = 0; i < count; i++) {
+        const int block = start + i * stride;
+        const int bit = block * m_bits;
+        if(static_cast<int>((m_words[bit >> 6] >> (bit & 63)) & m_mask) == fromIndex) {
+            setIndex(block, toIndex);
+        }
+    }
+}
+
+void PalettedBlocks::decode(BlockType *out) const {
+    decodeRange(0, m_size, out);
+}
+
+void PalettedBlocks::decodeRange(int start, int count, BlockType *out) const {
+    if(m_bits == 0) {
+        std::fill_n(out, count, m_palette[0]);
+        return;
+    }
+    const int perWord = 64 / m_bits;
+    int i = start;
+    const int end = start + count;
+    // Blocks up to the first word boundary, whole words, then the rest
+    while(i < end && i % perWord != 0) {
+        *out++ = get(i++);
+    }
+    for(; i + perWord <= end; i += perWord) {
+        uint64_t word = m_words[i / perWord];
+        for(int j = 0; j < perWord; j++, word >>= m_bits) {
+            *out++ = m_palette[word & m_mask];
+        }
+    }
+    while(i < end) {
+        *out++ = get(i++);
+    }
+}
+
+void PalettedBlocks::compact() {
+    if(m_bits == 0) {
+        return;
+    }
+    std::array<int, BLOCK_TYPE_COUNT> uses = {};
+    const int perWord = 64 / m_bits;
+    for(uint64_t word : m_words) {
+        for(int j = 0; j < perWord; j++, word >>= m_bits) {
+            uses[word & m_mask]++;
+        }
+    }
+    std::array<BlockType, BLOCK_TYPE_COUNT> palette = {};
+    std::array<uint64_t, BLOCK_TYPE_COUNT> remap = {};
+    int paletteSize = 0;
+    for(int p = 0; p < m_paletteSize; p++) {
+        if(uses[p] > 0) {
+            remap[p] = paletteSize;
+            palette[paletteSize++] = m_palette[p];
+        }
+    }
+    if(paletteSize < m_paletteSize || bitsFor(paletteSize) != m_bits) {
+        m_palette = palette;
+        m_paletteSize = paletteSize;
+        repack(bitsFor(paletteSize), remap);
+    }
+}
+
+size_t PalettedBlocks::bytes() const {
+    return sizeof(m_palette) + m_words.capacity() * sizeof(uint64_t);
+}
+
+int PalettedBlocks::paletteIndex(BlockType t) {
+    for(int p = 0; p < m_paletteSize; p++) {
+        if(m_palette[p] == t) {
+            return p;
+        }
+    }
+    m_palette[m_paletteSize++] = t;
+    const int bits = bitsFor(m_paletteSize);
+    if(bits != m_bits) {
+        std::array<uint64_t, BLOCK_TYPE_COUNT> remap;
+        for(int p = 0; p < BLOCK_TYPE_COUNT; p++) {
+            remap[p] = p;
+        }
+        repack(bits, remap);
+    }
+    return m_paletteSize - 1;
+}
+
+void PalettedBlocks::repack(int bits, const std::array<uint64_t, BLOCK_TYPE_COUNT> &remap) {
+    std::vector<uint64_t> words(m_size * bits / 64, 0);
+    if(m_bits == 0) {
+        // Every block was index 0
+        uint64_t pattern = 0;
+        for(int shift = 0; shift < 64; shift += bits) {
+            pattern |= remap[0] << shift;
+        }
+        std::fill(words.begin(), words.end(), pattern);
+    } else if(bits > 0) {
+        const int perWord = 64 / m_bits;
+        uint64_t *out = words.data();
+        uint64_t packed = 0;
+        int shift = 0;
+        for(uint64_t word : m_words) {
+            // Runs of index 0, e.g. all the air of a fresh Chunk, stay 0
+            if(word == 0 && remap[0] == 0 && shift == 0 && bits >= m_bits) {
+                out += bits / m_bits;
+                continue;
+            }
+            for(int j = 0; j < perWord; j++, word >>= m_bits) {
+                packed |= remap[word & m_mask] << shift;
+                shift += bits;
+                if(shift == 64) {
+                    *out++ = packed;
+                    packed = 0;
+                    shift = 0;
+                }
+            }
+        }
+    }
+    m_bits = bits;
+    m_mask = (uint64_t(1) << bits) - 1;
+    m_words = std::move(words);
+}
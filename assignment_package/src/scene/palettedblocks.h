@@ -0,0 +1,79 @@
+#pragma once
+#include "blockregistry.h"
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// Compact storage for a fixed number of blocks. Each block is stored as an
+// index into a palette of the BlockTypes that occur among them, and the
+// indices are bit-packed 1, 2, 4 or 8 to a block. Since most Chunks hold
+// only a handful of types, this usually takes an eighth to a half of the
+// memory of one byte per block. The width grows automatically when a new
+// type is added, and compact() shrinks it again.
+//
+// While every block is of the same type no indices are stored at all,
+// so all-air or all-stone blocks cost no more than their palette. The
+// palette itself is stored inline, so that costs no heap memory either.
+//
+// Not thread safe: setting a block may reallocate the packed indices,
+// so nothing may read the blocks while they are being written.
+class PalettedBlocks {
+public:
+    // size blocks of type fill. size must be a multiple of 64.
+    PalettedBlocks(int size, BlockType fill = EMPTY);
+
+    BlockType get(int i) const {
+        if(m_bits == 0) {
+            return m_palette[0];
+        }
+        const int bit = i * m_bits;
+        return m_palette[(m_words[bit >> 6] >> (bit & 63)) & m_mask];
+    }
+    void set(int i, BlockType t);
+    // Sets count blocks, starting at block start and stepping by stride
+    void fill(int start, int stride, int count, BlockType t);
+    // Like fill, but only changes blocks of type from
+    void replace(int start, int stride, int count, BlockType from, BlockType to);
+
+    // Writes every block to out, which must hold size() blocks.
+    // Much faster than calling get() for each of them.
+    void decode(BlockType *out) const;
+    // Writes blocks start to start + count - 1 to out
+    void decodeRange(int start, int count, BlockType *out) const;
+
+    // Drops palette entries no block uses any more,
+    // and packs the indices as tightly as possible
+    void compact();
+
+    int size() const { return m_size; }
+    // 0 while the blocks are uniform
+    int bitsPerBlock() const { return m_bits; }
+    int paletteSize() const { return m_paletteSize; }
+    // Whether every block is known to be of uniformType(). Blocks that
+    // became uniform through set() only count after compact().
+    bool isUniform() const { return m_bits == 0; }
+    BlockType uniformType() const { return m_palette[0]; }
+    // Memory used by the palette and the packed indices
+    size_t bytes() const;
+
+private:
+    int m_size;
+    int m_bits;
+    uint64_t m_mask;
+    // Can never hold more than one entry per BlockType
+    std::array<BlockType, BLOCK_TYPE_COUNT> m_palette;
+    int m_paletteSize;
+    std::vector<uint64_t> m_words;
+
+    // The palette index of t, adding it (and widening
+    // the indices if need be) if it is not there yet
+    int paletteIndex(BlockType t);
+    // Repacks every block at bits per block, mapping
+    // each palette index i to remap[i] along the way
+    void repack(int bits, const std::array<uint64_t, BLOCK_TYPE_COUNT> &remap);
+    void setIndex(int i, uint64_t index) {
+        const int bit = i * m_bits;
+        uint64_t &word = m_words[bit >> 6];
+        word = (word & ~(m_mask << (bit & 63))) | (index << (bit & 63));
+    }
+};
@@ -75,13 +75,13 @@ void Player::processInputs(InputBundle &inputs) {
             this->m_acceleration = this->acceleration * glm::normalize(glm::vec3(this->m_right.x, 0.f, this->m_right.z));
         } else if (inputs.spacePressed == true) {
             BlockType underPlayer = this->mcr_terrain.getBlockAt(this->m_position.x, this->m_position.y - 0.5, this->m_position.z);
-            if (underPlayer != EMPTY) {
+            if (blockInfo(underPlayer).collides) {
                 this->m_velocity.y = this->upSpeed;
             } // else do nothing since the character has jumped up
         } else {
             // reset the velocity
             BlockType underPlayer = this->mcr_terrain.getBlockAt(this->m_position.x, this->m_position.y - 0.5, this->m_position.z);
-            if (underPlayer == EMPTY) {
+            if (!blockInfo(underPlayer).collides) {
                 this->m_velocity = glm::vec3(0.f, this->m_velocity.y, 0.f);
                 this->m_acceleration = glm::vec3(0.f, -1.f * this->g, 0.f);
             } else {
@@ -97,7 +97,7 @@ void Player::computePhysics(float dT, const Terrain &terrain) {
     // and velocity, and also perform collision detection.
     if (this->flightMode == false) {
         BlockType underPlayer = this->mcr_terrain.getBlockAt(this->m_position.x, this->m_position.y - 0.5, this->m_position.z);
-        if (dT == 0 && underPlayer == EMPTY) {
+        if (dT == 0 && !blockInfo(underPlayer).collides) {
             dT = 1.f;
         }
         this->m_velocity *= 0.99;
@@ -195,17 +195,9 @@ void Player::placeBlock(Terrain* t) {
     bool result = gridMarch(ray_origin, ray_direction, this->mcr_terrain, &out_dist, &out_blockHit);
     if (result == false) {
         out_blockHit = this->m_camera.mcr_position + 3.f * glm::normalize(this->m_forward);
-        Chunk* c = t->getChunkAt(out_blockHit.x, out_blockHit.z).get();
-        glm::vec2 chunkOrigin = glm::vec2(floor(out_blockHit.x / 16.f) * 16, floor(out_blockHit.z / 16.f) * 16);
-
-        c->setBlockAt(static_cast<unsigned int>(out_blockHit.x - chunkOrigin.x),
-                             static_cast<unsigned int>(out_blockHit.y),
-                             static_cast<unsigned int>(out_blockHit.z - chunkOrigin.y), STONE);
-        t->getChunkAt(out_blockHit.x, out_blockHit.z).get()->destroyVBOdata();
-        t->getChunkAt(out_blockHit.x, out_blockHit.z).get()->createVBOdata();
-
-//        c->setBlockAt()
-//        t->setBlockAt(out_blockHit.x, out_blockHit.y, out_blockHit.z, STONE);
+        // Through Terrain, which remeshes the Chunk in the background and
+        // saves its zone rather than regenerating it once it is evicted
+        t->setBlockAt(out_blockHit.x, out_blockHit.y, out_blockHit.z, STONE);
     }
 }
 
@@ -0,0 +1,8 @@
+#include "stageworker.h"
+
+StageWorker::StageWorker(GenerationPipeline* pipeline, int64_t key, GenStage stage): pipeline(pipeline), key(key), stage(stage)
+{}
+
+void StageWorker::run() {
+    pipeline->runTask(key, stage);
+}
@@ -0,0 +1,20 @@
+#ifndef STAGEWORKER_H
+#define STAGEWORKER_H
+
+#include <QRunnable>
+#include "generationpipeline.h"
+
+// Runs a single GenerationPipeline stage of one Chunk (or,
+// for GenStage::Heightmap, of one zone)
+class StageWorker : public QRunnable
+{
+protected:
+    GenerationPipeline* pipeline;
+    int64_t key;
+    GenStage stage;
+public:
+    StageWorker(GenerationPipeline* pipeline, int64_t key, GenStage stage);
+    void run() override;
+};
+
+#endif // STAGEWORKER_H
@@ -1,67 +1,76 @@
 #include "terrain.h"
 #include "cube.h"
+#include "worldfile.h"
+#include <QDir>
+#include <algorithm>
+#include <fstream>
 #include <stdexcept>
 #include <iostream>
 #include <math.h>
 #include <random>
 
-enum BiomeType { Grass,Mountain };
+// Several thousand Chunks, or a few hundred zones, of typical terrain
+static const size_t DEFAULT_MEMORY_BUDGET = size_t(64) << 20;
 
-Terrain::Terrain(OpenGLContext *context)
-    : m_chunks(), m_generatedTerrain(), m_geomCube(context), mp_context(context)
-{}
-
-Terrain::~Terrain() {
-    m_geomCube.destroyVBOdata();
+// The lower-left corner of the zone containing coordinate v,
+// as ChunkMap::chunkOrigin does for Chunks
+static int zoneOrigin(int v) {
+    return v & ~63;
 }
 
-// Combine two 32-bit ints into one 64-bit int
-// where the upper 32 bits are X and the lower 32 bits are Z
-int64_t toKey(int x, int z) {
-    int64_t xz = 0xffffffffffffffff;
-    int64_t x64 = x;
-    int64_t z64 = z;
-
-    // Set all lower 32 bits to 1 so we can & with Z later
-    xz = (xz & (x64 << 32)) | 0x00000000ffffffff;
-
-    // Set all upper 32 bits to 1 so we can & with XZ
-    z64 = z64 | 0xffffffff00000000;
+// The lower-left corner of the zone containing a world-space position
+static glm::ivec2 zoneContaining(glm::vec3 p) {
+    return glm::ivec2(zoneOrigin(static_cast<int>(glm::floor(p.x))), zoneOrigin(static_cast<int>(glm::floor(p.z))));
+}
 
-    // Combine
-    xz = xz & z64;
-    return xz;
+// The key of the zone containing these world-space coordinates
+static int64_t zoneKeyAt(int x, int z) {
+    return toKey(zoneOrigin(x), zoneOrigin(z));
 }
 
-glm::ivec2 toCoords(int64_t k) {
-    // Z is lower 32 bits
-    int64_t z = k & 0x00000000ffffffff;
-    // If the most significant bit of Z is 1, then it's a negative number
-    // so we have to set all the upper 32 bits to 1.
-    // Note the 8    V
-    if(z & 0x0000000080000000) {
-        z = z | 0xffffffff00000000;
-    }
-    int64_t x = (k >> 32);
+Terrain::Terrain(OpenGLContext *context)
+    : m_chunkPool(context), m_chunks(m_chunkPool), m_directory(), m_chunksMade(), m_chunksMadeLock(),
+      m_linkLock(), m_generatedTerrain(),
+      m_memoryBudget(DEFAULT_MEMORY_BUDGET), m_chunkBytes(0), m_zoneLastUsed(), m_expansionTick(0),
+      m_editedZones(), m_savedZones(),
+      m_savePrefix(QDir::temp().filePath("mini-minecraft-zone").toStdString()), m_worldPrefix(),
+      m_meshesInFlight(), m_evictionCounters(), m_zonesLoaded(0),
+      m_pipeline(QThreadPool::globalInstance(), [this](Chunk *c) { linkFinishedChunk(c); }),
+      m_geomCube(context), mp_context(context)
+{}
 
-    return glm::ivec2(x, z);
+Terrain::~Terrain() {
+    m_geomCube.destroyVBOdata();
 }
 
 // Surround calls to this with try-catch if you don't know whether
 // the coordinates at x, y, z have a corresponding Chunk
 BlockType Terrain::getBlockAt(int x, int y, int z) const
 {
-    if(hasChunkAt(x, z)) {
+    const Chunk *c = m_chunks.find(x, z);
+    // A worker has yet to make this Chunk of a generated zone
+    if(c == nullptr && hasZoneAt(x, z)) {
+        return EMPTY;
+    }
+    if(c != nullptr) {
         // Just disallow action below or above min/max height,
         // but don't crash the game over it.
         if(y < 0 || y >= 256) {
             return EMPTY;
         }
-        const uPtr<Chunk> &c = getChunkAt(x, z);
-        glm::vec2 chunkOrigin = glm::vec2(floor(x / 16.f) * 16, floor(z / 16.f) * 16);
-        return c->getBlockAt(static_cast<unsigned int>(x - chunkOrigin.x),
+        // Nor over a Chunk that is still being generated on another thread
+        if(!c->hasBlockData) {
+            return EMPTY;
+        }
+        const int localX = x & 15, localZ = z & 15;
+        // Most rays and collision tests are in the open air, above the
+        // ground or in caves, where the masks say there is nothing to decode
+        if(y > c->topNonAir(localX, localZ) || !c->hasBlockAt(localX, y, localZ)) {
+            return EMPTY;
+        }
+        return c->getBlockAt(static_cast<unsigned int>(localX),
                              static_cast<unsigned int>(y),
-                             static_cast<unsigned int>(z - chunkOrigin.y));
+                             static_cast<unsigned int>(localZ));
     }
     else {
         throw std::out_of_range("Coordinates " + std::to_string(x) +
@@ -75,47 +84,56 @@ BlockType Terrain::getBlockAt(glm::vec3 p) const {
 }
 
 bool Terrain::hasChunkAt(int x, int z) const {
-    // Map x and z to their nearest Chunk corner
-    // By flooring x and z, then multiplying by 16,
-    // we clamp (x, z) to its nearest Chunk-space corner,
-    // then scale back to a world-space location.
-    // Note that floor() lets us handle negative numbers
-    // correctly, as floor(-1 / 16.f) gives us -1, as
-    // opposed to (int)(-1 / 16.f) giving us 0 (incorrect!).
-    int xFloor = static_cast<int>(glm::floor(x / 16.f));
-    int zFloor = static_cast<int>(glm::floor(z / 16.f));
-    return m_chunks.find(toKey(16 * xFloor, 16 * zFloor)) != m_chunks.end();
+    return m_chunks.contains(x, z);
 }
 
 //map to their nearest Zone corner
 bool Terrain::hasZoneAt(int x, int z) const {
-    int xFloor = static_cast<int>(glm::floor(x / 64.f));
-    int zFloor = static_cast<int>(glm::floor(z / 64.f));
-    return m_generatedTerrain.find(toKey(64 * xFloor, 64 * zFloor)) != m_generatedTerrain.end();
+    return m_generatedTerrain.find(zoneKeyAt(x, z)) != m_generatedTerrain.end();
 }
 
-uPtr<Chunk>& Terrain::getChunkAt(int x, int z) {
-    int xFloor = static_cast<int>(glm::floor(x / 16.f));
-    int zFloor = static_cast<int>(glm::floor(z / 16.f));
-    return m_chunks[toKey(16 * xFloor, 16 * zFloor)];
+const ZoneMap* Terrain::getZoneMapAt(int x, int z) const {
+    return m_pipeline.zoneMapAt(glm::ivec2(zoneOrigin(x), zoneOrigin(z)));
 }
 
-
-const uPtr<Chunk>& Terrain::getChunkAt(int x, int z) const {
-    int xFloor = static_cast<int>(glm::floor(x / 16.f));
-    int zFloor = static_cast<int>(glm::floor(z / 16.f));
-    return m_chunks.at(toKey(16 * xFloor, 16 * zFloor));
+Chunk* Terrain::getChunkAt(int x, int z) const {
+    return m_chunks.find(x, z);
 }
 
 void Terrain::setBlockAt(int x, int y, int z, BlockType t)
 {
-    if(hasChunkAt(x, z)) {
-        uPtr<Chunk> &c = getChunkAt(x, z);
-        glm::vec2 chunkOrigin = glm::vec2(floor(x / 16.f) * 16, floor(z / 16.f) * 16);
-        c->setBlockAt(static_cast<unsigned int>(x - chunkOrigin.x),
+    Chunk *c = m_chunks.find(x, z);
+    // Nor to a Chunk a worker has yet to make
+    if(c == nullptr && hasZoneAt(x, z)) {
+        return;
+    }
+    if(c != nullptr) {
+        if(!c->hasBlockData) {
+            return;
+        }
+        const int localX = x & 15;
+        const int localZ = z & 15;
+        const int64_t before = c->blockBytes();
+        c->setBlockAt(static_cast<unsigned int>(localX),
                       static_cast<unsigned int>(y),
-                      static_cast<unsigned int>(z - chunkOrigin.y),
+                      static_cast<unsigned int>(localZ),
                       t);
+        const int64_t grown = int64_t(c->blockBytes()) - before;
+        c->m_editedBytes += grown;
+        m_chunkBytes += grown;
+        m_editedZones.insert(zoneKeyAt(x, z));
+        // Remesh in the background. Meshes already being built from
+        // before this edit are found to be stale once they are done.
+        spawnVBOWorker(c);
+        const glm::ivec2 border[] = {{localX == 0 ? -1 : 0, 0}, {localX == 15 ? 1 : 0, 0},
+                                     {0, localZ == 0 ? -1 : 0}, {0, localZ == 15 ? 1 : 0}};
+        for(const glm::ivec2 &d : border) {
+            Chunk *n = d != glm::ivec2(0) ? getChunkAt(x + d.x, z + d.y) : nullptr;
+            if(n != nullptr && n->hasBlockData) {
+                n->bumpVersion();
+                spawnVBOWorker(n);
+            }
+        }
     }
     else {
         throw std::out_of_range("Coordinates " + std::to_string(x) +
@@ -125,39 +143,72 @@ void Terrain::setBlockAt(int x, int y, int z, BlockType t)
 }
 
 Chunk* Terrain::instantiateChunkAt(int x, int z) {
-    uPtr<Chunk> chunk = mkU<Chunk>(mp_context);
-    Chunk *cPtr = chunk.get();
-    m_chunks[toKey(x, z)] = move(chunk);
-    // Set the neighbor pointers of itself and its neighbors
-    if(hasChunkAt(x, z + 16)) {
-        auto &chunkNorth = m_chunks[toKey(x, z + 16)];
-        cPtr->linkNeighbor(chunkNorth, ZPOS);
-    }
-    if(hasChunkAt(x, z - 16)) {
-        auto &chunkSouth = m_chunks[toKey(x, z - 16)];
-        cPtr->linkNeighbor(chunkSouth, ZNEG);
-    }
-    if(hasChunkAt(x + 16, z)) {
-        auto &chunkEast = m_chunks[toKey(x + 16, z)];
-        cPtr->linkNeighbor(chunkEast, XPOS);
-    }
-    if(hasChunkAt(x - 16, z)) {
-        auto &chunkWest = m_chunks[toKey(x - 16, z)];
-        cPtr->linkNeighbor(chunkWest, XNEG);
-    }
+    ChunkHandle handle = m_chunkPool.acquire();
+    Chunk *cPtr = m_chunkPool.get(handle);
+    cPtr->m_position = glm::ivec2(x, z);
+    cPtr->m_count = 0;
+    m_directory.insert(x, z, cPtr);
+    m_chunksMadeLock.lock();
+    m_chunksMade.push_back(handle);
+    m_chunksMadeLock.unlock();
+    // Its neighbor pointers are only set by linkFinishedChunk,
+    // since the mesher reads through them
     return cPtr;
 }
 
+void Terrain::adoptChunks() {
+    std::vector<ChunkHandle> made;
+    m_chunksMadeLock.lock();
+    made.swap(m_chunksMade);
+    m_chunksMadeLock.unlock();
+    for(ChunkHandle handle : made) {
+        const glm::ivec2 pos = m_chunkPool.get(handle)->m_position;
+        m_chunks.insert(pos.x, pos.y, handle);
+        m_chunkBytes += sizeof(Chunk);
+    }
+}
+
+void Terrain::linkFinishedChunk(Chunk *c) {
+    const std::pair<glm::ivec2, Direction> edges[] = {{{0, 16}, ZPOS}, {{0, -16}, ZNEG},
+                                                      {{16, 0}, XPOS}, {{-16, 0}, XNEG}};
+    // The pipeline keeps c and its neighbors from being evicted
+    // until this returns, so the directory finds those very Chunks
+    m_linkLock.lock();
+    for(auto &edge : edges) {
+        glm::ivec2 pos = c->m_position + edge.first;
+        c->linkNeighbor(m_directory.find(pos.x, pos.y), edge.second);
+    }
+    m_linkLock.unlock();
+    m_chunksThatHaveBlockTypeDataLock.lock();
+    m_chunksThatHaveBlockTypeData.push_back(c);
+    m_chunksThatHaveBlockTypeDataLock.unlock();
+}
+
+void Terrain::markBlockDataReady(Chunk *c) {
+    c->hasBlockData = true;
+    const glm::ivec2 edges[] = {{0, 16}, {0, -16}, {16, 0}, {-16, 0}};
+    for(const glm::ivec2 &edge : edges) {
+        glm::ivec2 pos = c->m_position + edge;
+        Chunk *n = getChunkAt(pos.x, pos.y);
+        // The pipeline's lock orders the Finished neighbor's last writes
+        // before our first read. It may have been evicted since c was
+        // linked to it, and its zone be generated again.
+        if(n != nullptr && (n->hasBlockData || m_pipeline.isFinished(pos))) {
+            n->hasBlockData = true;
+        }
+    }
+}
+
 // TODO: When you make Chunk inherit from Drawable, change this code so
 // it draws each Chunk with the given ShaderProgram, remembering to set the
 // model matrix to the proper X and Z translation!
 void Terrain::draw(ShaderProgram *shaderProgram) {
-    for(auto& chunk: m_chunks) {
-        auto &c = chunk.second;
-        if(c->hasVBOdata) {
-            //chunk first is key, chunk second is the chunk uPtr
-            int x = toCoords(chunk.first).x;
-            int z = toCoords(chunk.first).y;
+    // Only Chunks near the player have VBOs,
+    // and all of them are in the resident grid
+    for(Chunk *c : m_chunks.resident()) {
+        if(c != nullptr && c->hasVBOdata) {
+            int x = c->m_position.x;
+            int z = c->m_position.y;
             shaderProgram->setModelMatrix(glm::translate(glm::mat4(), glm::vec3(x, 0, z)));
             shaderProgram->drawOpaque(*c);
         }
@@ -165,12 +216,12 @@ void Terrain::draw(ShaderProgram *shaderProgram) {
 }
 
 void Terrain::drawTransparent(ShaderProgram* shaderProgram) {
-    for(auto& chunk: m_chunks) {
-        auto &c = chunk.second;
-        if(c->hasVBOdata) {
-            //chunk first is key, chunk second is the chunk uPtr
-            int x = toCoords(chunk.first).x;
-            int z = toCoords(chunk.first).y;
+    // Only Chunks near the player have VBOs,
+    // and all of them are in the resident grid
+    for(Chunk *c : m_chunks.resident()) {
+        if(c != nullptr && c->hasVBOdata) {
+            int x = c->m_position.x;
+            int z = c->m_position.y;
             shaderProgram->setModelMatrix(glm::translate(glm::mat4(), glm::vec3(x, 0, z)));
             shaderProgram->drawTransparent(*c);
         }
@@ -230,14 +281,15 @@ void Terrain::CreateTestScene()
 }
 
 void Terrain::updateTerrain(glm::vec3 playerPos, glm::vec3 prevPos) {
+    m_chunks.recenter(static_cast<int>(glm::floor(playerPos.x)), static_cast<int>(glm::floor(playerPos.z)));
     tryExpansion(playerPos, prevPos);
     checkThreadResults();
+    evictZones(zoneContaining(playerPos));
 }
 
 void Terrain::tryExpansion(glm::vec3 playerPos, glm::vec3 prevPos) {
-    //  glm::ivec2 currChunkPos(16 * glm::ivec2(glm::floor(pPos / 16.f)));
-    glm::ivec2 currZone = glm::ivec2(glm::floor(playerPos.x / 64.f) * 64.f, glm::floor(playerPos.z / 64.f) * 64.f);
-    glm::ivec2 prevZone = glm::ivec2(glm::floor(prevPos.x / 64.f) * 64.f, glm::floor(prevPos.z / 64.f) * 64.f);
+    glm::ivec2 currZone = zoneContaining(playerPos);
+    glm::ivec2 prevZone = zoneContaining(prevPos);
 
 
 
@@ -253,32 +305,36 @@ void Terrain::tryExpansion(glm::vec3 playerPos, glm::vec3 prevPos) {
             //delete all chunks in that zone
             for(int x = coord.x; x < coord.x + 64; x += 16) {
                 for(int z = coord.y; z < coord.y + 64; z += 16) {
-                    auto& chunk = getChunkAt(x, z);
-                    chunk->destroyVBOdata();
+                    Chunk *chunk = getChunkAt(x, z);
+                    if(chunk != nullptr) {
+                        chunk->destroyVBOdata();
+                    }
                 }
             }
         }
     }
+    m_expansionTick++;
     for(auto id: currZoneNeighrbors) {
+        m_zoneLastUsed[id] = m_expansionTick;
         glm::ivec2 zone = toCoords(id);
         //if already set up chunks, feed them vbo data
         if(hasZoneAt(zone.x,zone.y)) {
             if(!prevZoneNeighrbors.contains(id)) {
                 for(int x = zone.x; x < zone.x + 64; x += 16) {
                     for(int z = zone.y; z < zone.y + 64; z += 16) {
-                        auto& chunk = getChunkAt(x, z);
-                        //TODO: createVBOWorker to createVBOData for chunks
-                        spawnVBOWorker(chunk.get());
+                        // Chunks still in the pipeline get their VBO
+                        // data as soon as they can be meshed
+                        Chunk *c = getChunkAt(x, z);
+                        if(c != nullptr && m_pipeline.isMeshable(glm::ivec2(x, z))) {
+                            spawnVBOWorker(c);
+                        }
                     }
                 }
             }
         }else{
-            //TODO: createFBMWorker to setup blocks for a zone
-            spawnFBMWorker(id);
+            generateZone(id);
         }
     }
-    if(currZone == prevZone) return;
-
 }
 
 QSet<int64_t> Terrain::terrainZonesBoarderingZone(glm::ivec2 zone) {
@@ -293,8 +349,16 @@ QSet<int64_t> Terrain::terrainZonesBoarderingZone(glm::ivec2 zone) {
 }
 
 void Terrain::spawnVBOWorker(Chunk *chunk) {
-    //TODO: Create VBO data for each chunk
-    VBOWorker* worker = new VBOWorker(chunk, &m_VBOData, &m_chunksThatHaveVBOsLock);
+    const int64_t key = toKey(chunk->m_position.x, chunk->m_position.y);
+    // A mesh already in flight is remeshed when it turns out to be stale
+    if(!chunk->hasBlockData || m_meshesInFlight.count(key) > 0) {
+        return;
+    }
+    m_meshesInFlight.insert(key);
+    m_linkLock.lock();
+    ChunkSnapshot snapshot = chunk->snapshot();
+    m_linkLock.unlock();
+    VBOWorker* worker = new VBOWorker(chunk, snapshot, &m_VBOData, &m_chunksThatHaveVBOsLock);
     QThreadPool::globalInstance()->start(worker);
 }
 
@@ -304,39 +368,143 @@ void Terrain::spawnVBOWorkers(const std::vector<Chunk*> chunksNeedingVBOData) {
     }
 }
 
-void Terrain::spawnFBMWorker(int64_t id) {
+void Terrain::generateZone(int64_t id) {
     m_generatedTerrain.insert(id);
-    std::vector<Chunk*> chunksforWorker;
     glm::ivec2 zone(toCoords(id));
-    //setup 16 chunks on generated terrain zone
-    for(int x = zone.x; x < zone.x + 64; x += 16) {
-        for(int z = zone.y; z < zone.y + 64; z += 16) {
-            Chunk *c = instantiateChunkAt(x,z);
-            c->m_position = glm::ivec2(x,z);
-            c->m_count = 0;
-            chunksforWorker.push_back(c);
+    if(m_savedZones.count(id) > 0) {
+        // An edited zone that was evicted comes back as the player left it.
+        // The zone stays edited, so it is saved again when evicted again.
+        m_savedZones.erase(id);
+        loadZone(zone, zoneSavePath(id));
+        return;
+    }
+    if(!m_worldPrefix.empty()) {
+        const std::string path = zoneFilePath(m_worldPrefix, zone);
+        if(std::ifstream(path).good()) {
+            loadZone(zone, path);
+            return;
         }
     }
-    FBMWorker *worker = new FBMWorker(zone, chunksforWorker, &m_chunksThatHaveBlockTypeData, &m_chunksThatHaveBlockTypeDataLock);
-    QThreadPool::globalInstance()->start(worker);
+    // The 16 Chunks are made on a worker, by the zone's first task
+    m_pipeline.addZone(zone, [this](glm::ivec2 pos) { return instantiateChunkAt(pos.x, pos.y); });
+}
+
+void Terrain::loadZone(glm::ivec2 zone, const std::string &path) {
+    std::atomic<uint64_t> *loadedZones = &m_zonesLoaded;
+    m_pipeline.addLoadedZone(zone, [this](glm::ivec2 pos) { return instantiateChunkAt(pos.x, pos.y); },
+                             [path, loadedZones](const std::vector<Chunk*> &chunks) {
+        // The file is read on a worker, so the Chunks it may fill are
+        // found by their corners here rather than through m_chunks
+        std::unordered_map<int64_t, Chunk*> byCorner;
+        for(Chunk *c : chunks) {
+            byCorner[toKey(c->m_position.x, c->m_position.y)] = c;
+        }
+        std::vector<Chunk*> filled;
+        // Chunks outside the zone make readWorldFile fail. Chunks missing
+        // from the file, which were not Finished when it was saved, are
+        // left EMPTY and generated instead.
+        const bool read = readWorldFile(path, [&](glm::ivec2 pos) -> Chunk* {
+            auto it = byCorner.find(toKey(pos.x, pos.y));
+            if(it == byCorner.end()) {
+                return nullptr;
+            }
+            filled.push_back(it->second);
+            return it->second;
+        });
+        // readWorldFile checks the whole file before filling anything
+        if(!read) {
+            std::cerr << "could not load " << path << ", generating it again\n";
+            return std::vector<Chunk*>();
+        }
+        for(Chunk *c : filled) {
+            c->compactBlocks();
+            c->updateMasks();
+        }
+        (*loadedZones)++;
+        return filled;
+    });
 }
 
 void Terrain::checkThreadResults() {
     //From slides
     //TODO: Handle worker results on the main thread and send vbo data to GPU
+    // Taken out from under the lock first: markBlockDataReady asks the
+    // pipeline about neighbors, and the pipeline's workers take its lock
+    // before ours
+    std::vector<Chunk*> ready;
     m_chunksThatHaveBlockTypeDataLock.lock();
-    spawnVBOWorkers(m_chunksThatHaveBlockTypeData);
-    m_chunksThatHaveBlockTypeData.clear();
+    ready.swap(m_chunksThatHaveBlockTypeData);
     m_chunksThatHaveBlockTypeDataLock.unlock();
+    // After the swap, so every Chunk in ready, and its neighbors,
+    // were made before and are found in m_chunks
+    adoptChunks();
+    for(Chunk *c : ready) {
+        markBlockDataReady(c);
+    }
+    spawnVBOWorkers(ready);
 
+    std::vector<Chunk*> stale;
     m_chunksThatHaveVBOsLock.lock();
     for(auto& cd: m_VBOData) {
-        cd.mp_chunk->createVBO(cd.m_trans, cd.m_transIdx, cd.m_op, cd.m_opIdx);
+        m_meshesInFlight.erase(toKey(cd.mp_chunk->m_position.x, cd.mp_chunk->m_position.y));
+        // The Chunk changed while it was being meshed. An outdated mesh
+        // still beats none at all, but it is replaced as soon as possible.
+        if(cd.m_version != cd.mp_chunk->version()) {
+            stale.push_back(cd.mp_chunk);
+            if(cd.mp_chunk->hasVBOdata) {
+                continue;
+            }
+        }
+        cd.mp_chunk->createVBO(cd);
         cd.mp_chunk->hasVBOdata = true;
     }
     m_VBOData.clear();
     m_chunksThatHaveVBOsLock.unlock();
+    spawnVBOWorkers(stale);
+
+}
 
+ChunkPoolCounters Terrain::chunkPoolCounters() const {
+    return m_chunkPool.counters();
+}
+
+void Terrain::setMeshingMode(MeshingMode mode) {
+    if(mode == Chunk::meshingMode()) {
+        return;
+    }
+    Chunk::setMeshingMode(mode);
+    remeshResident();
+}
+
+void Terrain::setVertexFormat(VertexFormat format) {
+    if(format == Chunk::vertexFormat()) {
+        return;
+    }
+    Chunk::setVertexFormat(format);
+    remeshResident();
+}
+
+void Terrain::remeshResident() {
+    for(Chunk *c : m_chunks.resident()) {
+        if(c != nullptr && c->hasVBOdata) {
+            // Meshes in flight in the old mode come back stale
+            c->bumpVersion();
+            spawnVBOWorker(c);
+        }
+    }
+}
+
+MeshStats Terrain::meshStats() const {
+    MeshStats stats = {};
+    for(Chunk *c : m_chunks.resident()) {
+        if(c != nullptr && c->hasVBOdata) {
+            stats.chunks++;
+            // 6 indices and 4 vertices per quad
+            stats.vertices += (c->elementOpqCount() + c->elementTransCount()) / 6 * 4;
+            stats.bytes += c->m_vboBytes;
+        }
+    }
+    return stats;
 }
 
 void Terrain::CreateSnow() {
@@ -358,3 +526,145 @@ void Terrain::createTestTerrainForChunk(glm::ivec2 newChunkPos) {
     }
 }
 
+
+void Terrain::setMemoryBudget(size_t bytes) {
+    m_memoryBudget = bytes;
+}
+
+size_t Terrain::memoryBudget() const {
+    return m_memoryBudget;
+}
+
+void Terrain::setSavePrefix(const std::string &prefix) {
+    m_savePrefix = prefix;
+}
+
+void Terrain::setWorldPrefix(const std::string &prefix) {
+    m_worldPrefix = prefix;
+}
+
+std::string Terrain::zoneSavePath(int64_t id) const {
+    return zoneFilePath(m_savePrefix, toCoords(id));
+}
+
+size_t Terrain::residentBytes() const {
+    return size_t(m_chunkBytes) + m_pipeline.memoryBytes();
+}
+
+ZoneEvictionCounters Terrain::zoneEvictionCounters() const {
+    ZoneEvictionCounters counters = m_evictionCounters;
+    counters.loaded = m_zonesLoaded;
+    return counters;
+}
+
+void Terrain::evictZones(glm::ivec2 currZone) {
+    size_t resident = residentBytes();
+    if(resident <= m_memoryBudget) {
+        return;
+    }
+    QSet<int64_t> inRange = terrainZonesBoarderingZone(currZone);
+    std::vector<std::pair<uint64_t, int64_t>> candidates;
+    for(int64_t id : m_generatedTerrain) {
+        if(!inRange.contains(id)) {
+            candidates.push_back({m_zoneLastUsed[id], id});
+        }
+    }
+    // Least recently used first
+    std::sort(candidates.begin(), candidates.end());
+    for(auto &candidate : candidates) {
+        if(resident <= m_memoryBudget) {
+            break;
+        }
+        if(evictZone(candidate.second)) {
+            resident = residentBytes();
+        } else {
+            m_evictionCounters.deferred++;
+        }
+    }
+}
+
+bool Terrain::evictZone(int64_t id) {
+    glm::ivec2 zone = toCoords(id);
+    // Its Chunks may have been made since checkThreadResults last ran
+    adoptChunks();
+    // VBOWorkers only read snapshots, but their results still name
+    // the Chunk they belong to
+    for(int x = zone.x; x < zone.x + 64; x += 16) {
+        for(int z = zone.y; z < zone.y + 64; z += 16) {
+            if(m_meshesInFlight.count(toKey(x, z)) > 0) {
+                return false;
+            }
+        }
+    }
+
+    std::vector<Chunk*> chunks;
+    // Only Finished Chunks are saved. The others would come back frozen
+    // without the trees, veins and neighbors' writes of their later
+    // stages, so they are generated again when the zone is loaded.
+    // A Chunk that finishes after it is checked here cannot have been
+    // edited yet, so generating it again gives the same blocks.
+    std::vector<const Chunk*> finished;
+    for(int x = zone.x; x < zone.x + 64; x += 16) {
+        for(int z = zone.y; z < zone.y + 64; z += 16) {
+            chunks.push_back(getChunkAt(x, z));
+            // The zone's first task, which makes them, has yet to run
+            if(chunks.back() == nullptr) {
+                return false;
+            }
+            if(m_pipeline.isFinished(glm::ivec2(x, z))) {
+                finished.push_back(chunks.back());
+            }
+        }
+    }
+    // Fails while a generation stage is queued or running for the zone.
+    // Once it succeeds the pipeline will not touch its Chunks again.
+    if(!m_pipeline.removeZone(zone)) {
+        return false;
+    }
+    const bool edited = m_editedZones.count(id) > 0;
+    if(edited && !writeWorldFile(zoneSavePath(id), finished)) {
+        std::cerr << "could not save " << zoneSavePath(id) << ", its edits are lost\n";
+        m_editedZones.erase(id);
+    }
+
+    // Finished Chunks that checkThreadResults has not picked up yet
+    m_chunksThatHaveBlockTypeDataLock.lock();
+    m_chunksThatHaveBlockTypeData.erase(
+        std::remove_if(m_chunksThatHaveBlockTypeData.begin(), m_chunksThatHaveBlockTypeData.end(),
+                       [&chunks](Chunk *c) { return std::find(chunks.begin(), chunks.end(), c) != chunks.end(); }),
+        m_chunksThatHaveBlockTypeData.end());
+    m_chunksThatHaveBlockTypeDataLock.unlock();
+
+    m_linkLock.lock();
+    for(Chunk *c : chunks) {
+        c->unlinkNeighbors();
+    }
+    m_linkLock.unlock();
+    for(Chunk *c : chunks) {
+        c->destroyVBOdata();
+        m_chunkBytes -= int64_t(sizeof(Chunk)) + c->m_editedBytes;
+        m_directory.erase(c->m_position.x, c->m_position.y);
+        m_chunkPool.release(m_chunks.erase(c->m_position.x, c->m_position.y));
+    }
+    // The Chunks around the zone were meshed with their border faces
+    // hidden by it. Those now face nothing, as on the edge of the world,
+    // so the ones that are drawn are meshed again.
+    for(int i = 0; i < 64; i += 16) {
+        const glm::ivec2 border[] = {{zone.x - 16, zone.y + i}, {zone.x + 64, zone.y + i},
+                                     {zone.x + i, zone.y - 16}, {zone.x + i, zone.y + 64}};
+        for(const glm::ivec2 &pos : border) {
+            Chunk *n = getChunkAt(pos.x, pos.y);
+            if(n != nullptr && n->hasVBOdata) {
+                spawnVBOWorker(n);
+            }
+        }
+    }
+    m_generatedTerrain.erase(id);
+    m_zoneLastUsed.erase(id);
+    m_evictionCounters.evicted++;
+    if(m_editedZones.count(id) > 0) {
+        m_savedZones.insert(id);
+        m_evictionCounters.saved++;
+    }
+    return true;
+}
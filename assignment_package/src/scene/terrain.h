@@ -2,21 +2,41 @@
 #include "smartpointerhelp.h"
 #include "glm_includes.h"
 #include "chunk.h"
+#include "chunkdirectory.h"
+#include "chunkmap.h"
+#include "chunkpool.h"
 #include <array>
+#include <atomic>
 #include <unordered_map>
 #include <unordered_set>
 #include "shaderprogram.h"
 #include "cube.h"
-#include "fbmworker.h"
+#include "generationpipeline.h"
 #include "vboworker.h"
 #include <QThreadPool>
+#include <string>
 
 
 //using namespace std;
 
-// Helper functions to convert (x, z) to and from hash map key
-int64_t toKey(int x, int z);
-glm::ivec2 toCoords(int64_t k);
+// Running totals of the zones Terrain has unloaded and brought back
+struct ZoneEvictionCounters {
+    uint64_t evicted;
+    // Evicted zones that had edits, and were written to a file
+    uint64_t saved;
+    // Zones read back from such a file instead of being generated again
+    uint64_t loaded;
+    // Times a zone was due for eviction, but had to wait for a worker
+    uint64_t deferred;
+};
+
+// The meshes of the Chunks Terrain currently draws
+struct MeshStats {
+    uint64_t chunks;
+    uint64_t vertices;
+    // Vertices and indices uploaded to the GPU
+    uint64_t bytes;
+};
 
 
 // The container class for all of the Chunks in the game.
@@ -25,12 +45,24 @@ glm::ivec2 toCoords(int64_t k);
 // expands.
 class Terrain {
 private:
-    // Stores every Chunk according to the location of its lower-left corner
-    // in world space.
+    // Owns the storage of every Chunk
+    ChunkPool m_chunkPool;
+    // Stores the handle of every Chunk according to the location of its
+    // lower-left corner in world space.
     // We combine the X and Z coordinates of the Chunk's corner into one 64-bit int
     // so that we can use them as a key for the map, as objects like std::pairs or
     // glm::ivec2s are not hashable by default, so they cannot be used as keys.
-    std::unordered_map<int64_t, uPtr<Chunk>> m_chunks;
+    ChunkMap m_chunks;
+    // Every Chunk again, for the workers: they make the Chunks and add
+    // them here, and find the neighbors to link them to here. The main
+    // thread adds them to m_chunks once it learns of them through
+    // m_chunksMade (see adoptChunks), and erases them from both.
+    ChunkDirectory m_directory;
+    std::vector<ChunkHandle> m_chunksMade;
+    QMutex m_chunksMadeLock;
+    // Held while neighbors are linked or unlinked, and while a Chunk
+    // that reads them is snapshotted
+    QMutex m_linkLock;
 
     // We will designate every 64 x 64 area of the world's x-z plane
     // as one "terrain generation zone". Every time the player moves
@@ -42,11 +74,35 @@ private:
     // one 64 x 64 area with its lower-left corner at (0, 0).
     // When milestone 1 has been implemented, the Player can move around the
     // world to add more "terrain generation zone" IDs to this set.
-    // While only the 3 x 3 collection of terrain generation zones
-    // surrounding the Player should be rendered, the Chunks
-    // in the Terrain will never be deleted until the program is terminated.
+    // Only the 5 x 5 collection of terrain generation zones surrounding
+    // the Player is rendered. Zones further away stay in memory until
+    // residentBytes() exceeds m_memoryBudget, then the least recently
+    // visited are evicted first (see evictZones).
     std::unordered_set<int64_t> m_generatedTerrain;
 
+    size_t m_memoryBudget;
+    // sizeof(Chunk) for every Chunk, plus what edits added to their blocks.
+    // The blocks as generated are counted by m_pipeline.
+    int64_t m_chunkBytes;
+    // When each zone was last within rendering range, in calls to tryExpansion
+    std::unordered_map<int64_t, uint64_t> m_zoneLastUsed;
+    uint64_t m_expansionTick;
+    // Zones the player has changed, which must be saved rather than
+    // generated again once evicted
+    std::unordered_set<int64_t> m_editedZones;
+    // Evicted zones whose blocks are in a file under m_savePrefix
+    std::unordered_set<int64_t> m_savedZones;
+    std::string m_savePrefix;
+    // Where pregenerated zones are looked for, if anywhere
+    std::string m_worldPrefix;
+    // Chunks with a VBOWorker queued or running, whose ChunkVBOData
+    // checkThreadResults has not picked up yet. There is at most one
+    // per Chunk, which is meshed again if it has changed meanwhile.
+    std::unordered_set<int64_t> m_meshesInFlight;
+    ZoneEvictionCounters m_evictionCounters;
+    // ZoneEvictionCounters::loaded, counted by the workers that load them
+    std::atomic<uint64_t> m_zonesLoaded;
+
     //blocktype worker
     std::vector<Chunk*> m_chunksThatHaveBlockTypeData;
     QMutex m_chunksThatHaveBlockTypeDataLock;
@@ -54,6 +110,13 @@ private:
     std::vector<ChunkVBOData> m_VBOData;
     QMutex m_chunksThatHaveVBOsLock;
 
+    // Runs every generation stage of every Chunk in m_generatedTerrain and
+    // owns their zones' height, moisture and biome maps. Finished Chunks
+    // are handed back through m_chunksThatHaveBlockTypeData.
+    // Declared after everything its workers touch so that it is destroyed
+    // (and waits for those workers) first.
+    GenerationPipeline m_pipeline;
+
     // TODO: DELETE ALL REFERENCES TO m_geomCube AS YOU WILL NOT USE
     // IT IN YOUR FINAL PROGRAM!
     // The instance of a unit cube we can use to render any cube.
@@ -69,28 +132,30 @@ public:
     Terrain(OpenGLContext *context);
     ~Terrain();
 
-    // Instantiates a new Chunk and stores it in
-    // our chunk map at the given coordinates.
-    // Returns a pointer to the created Chunk.
+    // Instantiates a new Chunk and stores it in m_directory at the
+    // given coordinates, and in m_chunks once adoptChunks picks it up.
+    // Returns a pointer to the created Chunk. Safe on any thread.
     Chunk* instantiateChunkAt(int x, int z);
     // Do these world-space coordinates lie within
     // a Chunk that exists?
     bool hasChunkAt(int x, int z) const;
     // a generated zone that exists?
     bool hasZoneAt(int x, int z) const;
-    // Assuming a Chunk exists at these coords,
-    // return a mutable reference to it
-    uPtr<Chunk>& getChunkAt(int x, int z);
-    // Assuming a Chunk exists at these coords,
-    // return a const reference to it
-    const uPtr<Chunk>& getChunkAt(int x, int z) const;
+    // Returns the height, moisture and biome maps of the zone
+    // containing these world-space coordinates, or nullptr if
+    // that zone has not finished generating yet.
+    const ZoneMap* getZoneMapAt(int x, int z) const;
+    // The Chunk containing these coords,
+    // or nullptr if there is none
+    Chunk* getChunkAt(int x, int z) const;
     // Given a world-space coordinate (which may have negative
     // values) return the block stored at that point in space.
     BlockType getBlockAt(int x, int y, int z) const;
     BlockType getBlockAt(glm::vec3 p) const;
     // Given a world-space coordinate (which may have negative
     // values) set the block at that point in space to the
-    // given type.
+    // given type, and remesh the Chunks it shows in. Does nothing
+    // while the Chunk is still being generated.
     void setBlockAt(int x, int y, int z, BlockType t);
 
     // Draws every Chunk that falls within the bounding box
@@ -123,10 +188,59 @@ public:
 
     void spawnVBOWorker(Chunk* chunk);
     void spawnVBOWorkers(const std::vector<Chunk*> chunksNeedingVBOData);
-
-    void spawnFBMWorker(int64_t id);
-    void spawnFBMWorkers(const QSet<int64_t> &zoneToGenerate);
+    // Remeshes every drawn Chunk, after the meshing mode or vertex format changed
+    void remeshResident();
+
+    // Hands a zone to m_pipeline, whose workers make its 16 Chunks
+    void generateZone(int64_t id);
+    // Has m_pipeline fill the zone's Chunks from the file at path, and
+    // generate those it does not hold, or all of them if it cannot be read
+    void loadZone(glm::ivec2 zone, const std::string &path);
+    // Called on a worker once m_pipeline has finished c and its 4 edge
+    // neighbors. Links them, and hands c to the main thread.
+    void linkFinishedChunk(Chunk *c);
+    // Called on the main thread for such a c. From then on the
+    // main thread owns its blocks and those of its neighbors.
+    void markBlockDataReady(Chunk *c);
+    // Adds the Chunks workers have made since the last call to m_chunks
+    void adoptChunks();
 
     void checkThreadResults();
 
+    // Arena and recycling totals of the Chunk storage
+    ChunkPoolCounters chunkPoolCounters() const;
+
+    // Switches between the naive and greedy mesher, and
+    // remeshes every Chunk that is drawn
+    void setMeshingMode(MeshingMode mode);
+    // Switches between packed and float vertices, and remeshes likewise
+    void setVertexFormat(VertexFormat format);
+    MeshStats meshStats() const;
+
+    // How many bytes of Chunks to keep in memory before evicting the zones
+    // furthest in the past. Zones within rendering range are never evicted,
+    // so this may be exceeded when it is set very low.
+    void setMemoryBudget(size_t bytes);
+    size_t memoryBudget() const;
+    // Evicted zones with edits are saved to prefix_<x>_<z>.mmcw
+    void setSavePrefix(const std::string &prefix);
+    // Zones generated from now on are loaded from prefix_<x>_<z>.mmcw
+    // instead wherever that file exists, as MiniMinecraftPregen --out
+    // prefix writes them. They should have been generated with the same
+    // seed, or they will not line up with the zones generated around them.
+    void setWorldPrefix(const std::string &prefix);
+    // Bytes used by every Chunk and its blocks, and by what generation
+    // keeps around for them, not counting VBOs
+    size_t residentBytes() const;
+    ZoneEvictionCounters zoneEvictionCounters() const;
+
+    // Evicts zones outside the 5 x 5 zones around currZone, least recently
+    // visited first, until residentBytes() fits the memory budget
+    void evictZones(glm::ivec2 currZone);
+    // Saves the Finished Chunks of the zone if it was edited and destroys
+    // its Chunks. Returns false, leaving it as it is, while a worker may
+    // still use any of its Chunks.
+    bool evictZone(int64_t id);
+    std::string zoneSavePath(int64_t id) const;
+
 };
@@ -0,0 +1,26 @@
+#pragma once
+#include "noisegraph.h"
+
+// The shape of our terrain as noisegraph expressions. Height(), Moisture()
+// and friends in noise.cpp evaluate these one column at a time, and the
+// batched kernel of noisebatch.cpp evaluates the very same graphs in SIMD
+// lanes, so changing the terrain only means changing a graph here.
+namespace terrainnoise {
+using namespace noisegraph;
+
+// Ridged peaks of 50 to 255 blocks from Worley noise of the folded world
+constexpr auto MOUNTAIN = clamp(remap(cosWarp(worley(), 128.f), 50.f, 255.f), 0.f, 255.f);
+
+// Eight octaves of value noise for the rolling grass hills
+constexpr auto GRASS_OCTAVES = octaves(valueNoise(), 8, 4.f, 0.125f, 2.f, 0.25f);
+// The height of a grass column given the value of its octaves
+constexpr auto GRASS_SHAPE = clamp(affine(remap(affine(X(), 10.f, 0.f), 0.2f, 0.7f), 70.f, 111.f), 0.f, 255.f);
+constexpr auto GRASS = map(cosWarp(GRASS_OCTAVES, 64.f), GRASS_SHAPE);
+
+// How far to blend from mountain to grass, given the two heights
+constexpr auto BIOME_WEIGHT = smoothStep(scale(absDomain(worley()), 2560.f), 0.27f, 0.42f);
+
+constexpr auto HEIGHT = blend(MOUNTAIN, GRASS, BIOME_WEIGHT);
+constexpr auto MOISTURE = scale(absDomain(worley()), 2056.f);
+
+} // namespace terrainnoise
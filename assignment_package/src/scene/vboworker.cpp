@@ -1,11 +1,12 @@
 #include "vboworker.h"
 
-VBOWorker::VBOWorker(Chunk* c, vector<ChunkVBOData>* v, QMutex* m): chunk(c), chunksThatHaveVBOs(v), chunksThatHaveVBOsLock(m)
+VBOWorker::VBOWorker(Chunk* c, const ChunkSnapshot &s, vector<ChunkVBOData>* v, QMutex* m): chunk(c), snapshot(s), chunksThatHaveVBOs(v), chunksThatHaveVBOsLock(m)
 {}
 
 void VBOWorker::run() {
-    chunk->createVBOdata();
+    ChunkVBOData data(chunk);
+    Chunk::createVBOdata(snapshot, data);
     chunksThatHaveVBOsLock->lock();
-    chunksThatHaveVBOs->push_back(chunk->m_chunkVBOData);
+    chunksThatHaveVBOs->push_back(std::move(data));
     chunksThatHaveVBOsLock->unlock();
 }
@@ -7,14 +7,18 @@
 #include "terrain.h"
 using namespace std;
 
+// Meshes a snapshot of a Chunk, so it never reads the Chunk itself and
+// the main thread may go on editing it. The Chunk pointer only tells
+// the main thread which Chunk the result belongs to.
 class VBOWorker : public QRunnable
 {
 protected:
     Chunk* chunk;
+    ChunkSnapshot snapshot;
     vector<ChunkVBOData>* chunksThatHaveVBOs;
     QMutex* chunksThatHaveVBOsLock;
 public:
-    VBOWorker(Chunk* c, vector<ChunkVBOData>* v, QMutex* m);
+    VBOWorker(Chunk* c, const ChunkSnapshot &s, vector<ChunkVBOData>* v, QMutex* m);
     void run() override;
 };
 #endif // VBOWORKER_H
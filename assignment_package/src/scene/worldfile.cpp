@@ -0,0 +1,124 @@
+#include "worldfile.h"
+#include <fstream>
+#include <iterator>
+
+static const char MAGIC[4] = {'M', 'M', 'C', 'W'};
+static const uint32_t VERSION = 1;
+
+static void putU32(std::vector<unsigned char> &out, uint32_t v) {
+    for(int i = 0; i < 4; i++) {
+        out.push_back(static_cast<unsigned char>(v >> (8 * i)));
+    }
+}
+
+static bool getU32(const std::vector<unsigned char> &in, size_t &pos, uint32_t &v) {
+    if(pos + 4 > in.size()) {
+        return false;
+    }
+    v = 0;
+    for(int i = 0; i < 4; i++) {
+        v |= static_cast<uint32_t>(in[pos++]) << (8 * i);
+    }
+    return true;
+}
+
+bool writeWorldFile(const std::string &path, const std::vector<const Chunk*> &chunks) {
+    std::vector<unsigned char> out(MAGIC, MAGIC + 4);
+    putU32(out, VERSION);
+    putU32(out, static_cast<uint32_t>(chunks.size()));
+    for(const Chunk *c : chunks) {
+        putU32(out, static_cast<uint32_t>(c->m_position.x));
+        putU32(out, static_cast<uint32_t>(c->m_position.y));
+        for(int z = 0; z < 16; z++) {
+            for(int x = 0; x < 16; x++) {
+                int y = 0;
+                while(y < 256) {
+                    BlockType t = c->getBlockAt(x, y, z);
+                    int run = 1;
+                    while(y + run < 256 && c->getBlockAt(x, y + run, z) == t) {
+                        run++;
+                    }
+                    out.push_back(t);
+                    out.push_back(static_cast<unsigned char>(run - 1));
+                    y += run;
+                }
+            }
+        }
+    }
+
+    std::ofstream file(path, std::ios::binary);
+    if(!file) {
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(out.data()), out.size());
+    return static_cast<bool>(file);
+}
+
+bool readWorldFile(const std::string &path, const std::function<Chunk*(glm::ivec2)> &makeChunk) {
+    std::ifstream file(path, std::ios::binary);
+    if(!file) {
+        return false;
+    }
+    std::vector<unsigned char> in((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if(in.size() < 4 || !std::equal(MAGIC, MAGIC + 4, in.begin())) {
+        return false;
+    }
+    size_t pos = 4;
+    uint32_t version, count;
+    if(!getU32(in, pos, version) || version != VERSION || !getU32(in, pos, count)) {
+        return false;
+    }
+    // Check the whole file before touching any Chunk, so that a corrupt
+    // or truncated one leaves them all as they were.
+    // Each Chunk's corner and where its columns start.
+    std::vector<std::pair<glm::ivec2, size_t>> stored;
+    for(uint32_t i = 0; i < count; i++) {
+        uint32_t x, z;
+        if(!getU32(in, pos, x) || !getU32(in, pos, z)) {
+            return false;
+        }
+        stored.push_back({glm::ivec2(static_cast<int32_t>(x), static_cast<int32_t>(z)), pos});
+        for(int column = 0; column < 256; column++) {
+            int y = 0;
+            while(y < 256) {
+                if(pos + 2 > in.size() || in[pos] >= BLOCK_TYPE_COUNT) {
+                    return false;
+                }
+                y += in[pos + 1] + 1;
+                pos += 2;
+                if(y > 256) {
+                    return false;
+                }
+            }
+        }
+    }
+    if(pos != in.size()) {
+        return false;
+    }
+    std::vector<Chunk*> chunks;
+    for(const auto &chunk : stored) {
+        chunks.push_back(makeChunk(chunk.first));
+        if(chunks.back() == nullptr) {
+            return false;
+        }
+    }
+
+    for(size_t i = 0; i < stored.size(); i++) {
+        pos = stored[i].second;
+        for(int column = 0; column < 256; column++) {
+            int y = 0;
+            while(y < 256) {
+                BlockType t = static_cast<BlockType>(in[pos]);
+                int run = in[pos + 1] + 1;
+                pos += 2;
+                chunks[i]->fillColumn(column % 16, column / 16, y, y + run, t);
+                y += run;
+            }
+        }
+    }
+    return true;
+}
+
+std::string zoneFilePath(const std::string &prefix, glm::ivec2 zonePos) {
+    return prefix + "_" + std::to_string(zonePos.x) + "_" + std::to_string(zonePos.y) + ".mmcw";
+}
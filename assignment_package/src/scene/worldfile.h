@@ -0,0 +1,28 @@
+#pragma once
+#include "chunk.h"
+#include <functional>
+#include <string>
+#include <vector>
+
+// Saves Chunks' blocks to a compact file, so that pregenerated areas of
+// the world can be loaded later without running terrain generation.
+//
+// The file holds the magic "MMCW", a version and a Chunk count, then for
+// every Chunk its lower-left corner and its 256 columns (x + 16 * z).
+// Each column is a list of (type, length - 1) byte pairs that together
+// cover y = 0 to 255, so a column costs only a few bytes and is loaded
+// with a few fillColumn calls. Integers are stored little-endian.
+//
+// Both functions return false if the file could not be opened, or
+// could not be parsed.
+bool writeWorldFile(const std::string &path, const std::vector<const Chunk*> &chunks);
+// Calls makeChunk with each Chunk's lower-left corner, then fills the
+// returned Chunk with the blocks stored for it. The whole file is
+// checked first, block types included, and makeChunk must return a
+// Chunk for every corner, so nothing is filled unless all of it can be.
+bool readWorldFile(const std::string &path, const std::function<Chunk*(glm::ivec2)> &makeChunk);
+
+// Where the zone whose lower-left corner is zonePos is stored, one file
+// per zone: prefix_<x>_<z>.mmcw. Terrain saves evicted zones this way,
+// and MiniMinecraftPregen --out writes its zones this way for it to load.
+std::string zoneFilePath(const std::string &prefix, glm::ivec2 zonePos);
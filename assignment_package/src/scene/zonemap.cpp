@@ -0,0 +1,39 @@
+#include "zonemap.h"
+#include "noise.h"
+#include <cassert>
+
+BiomeType biomeFor(float height, float moisture) {
+    return (height>150) ? ((moisture>0.45)? Mountain : Snowland) : ((moisture>0.45)? Grass : Desert);
+}
+
+ZoneMap::ZoneMap(glm::ivec2 zonePos)
+    : m_zonePos(zonePos), m_heights(), m_moistures(), m_biomes()
+{
+    batchColumnNoiseGrid(zonePos - glm::ivec2(APRON), SIZE, SIZE, m_heights.data(), m_moistures.data());
+    for(int i = 0; i < SIZE * SIZE; i++) {
+        m_biomes[i] = biomeFor(m_heights[i], m_moistures[i]);
+    }
+}
+
+glm::ivec2 ZoneMap::zonePos() const {
+    return m_zonePos;
+}
+
+// A column outside the apron would alias a column of another row, so
+// this is checked even though at() would catch only the far ends
+int ZoneMap::index(int x, int z) {
+    assert(x >= -APRON && x < ZONE_SIZE + APRON && z >= -APRON && z < ZONE_SIZE + APRON);
+    return (x + APRON) + SIZE * (z + APRON);
+}
+
+float ZoneMap::heightAt(int x, int z) const {
+    return m_heights[index(x, z)];
+}
+
+float ZoneMap::moistureAt(int x, int z) const {
+    return m_moistures[index(x, z)];
+}
+
+BiomeType ZoneMap::biomeAt(int x, int z) const {
+    return m_biomes[index(x, z)];
+}
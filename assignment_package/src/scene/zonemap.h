@@ -0,0 +1,46 @@
+#pragma once
+#include "glm_includes.h"
+#include <array>
+
+enum BiomeType : unsigned char
+{
+    Grass, Mountain, Snowland, Desert
+};
+
+// Picks the biome of a column from its terrain height and moisture
+BiomeType biomeFor(float height, float moisture);
+
+// The height, moisture and biome of every column in one 64 x 64
+// terrain generation zone. These are computed once per zone, before
+// any of its 16 Chunks are filled, and are kept around afterwards so
+// later passes (decoration, lighting, physics) can look a column up
+// instead of re-evaluating the noise.
+// The maps also cover a one-column apron around the zone, so features
+// that depend on their neighboring columns can be placed on the zone's
+// border without touching the neighboring zone.
+class ZoneMap {
+public:
+    static const int ZONE_SIZE = 64;
+    static const int APRON = 1;
+    static const int SIZE = ZONE_SIZE + 2 * APRON;
+
+    // Evaluates the terrain noise for every column of the zone whose
+    // lower-left corner is zonePos. Safe to call from any thread.
+    ZoneMap(glm::ivec2 zonePos);
+
+    glm::ivec2 zonePos() const;
+
+    // Coordinates are relative to the zone's lower-left corner and may
+    // range from -APRON to ZONE_SIZE - 1 + APRON.
+    float heightAt(int x, int z) const;
+    float moistureAt(int x, int z) const;
+    BiomeType biomeAt(int x, int z) const;
+
+private:
+    glm::ivec2 m_zonePos;
+    std::array<float, SIZE * SIZE> m_heights;
+    std::array<float, SIZE * SIZE> m_moistures;
+    std::array<BiomeType, SIZE * SIZE> m_biomes;
+
+    static int index(int x, int z);
+};
@@ -9,9 +9,9 @@
 
 ShaderProgram::ShaderProgram(OpenGLContext *context)
     : vertShader(), fragShader(), prog(),
-      attrPos(-1), attrNor(-1), attrCol(-1), attrUV(-1),
+      attrPos(-1), attrNor(-1), attrCol(-1), attrUV(-1), attrPacked(-1),
       unifModel(-1), unifModelInvTr(-1), unifViewProj(-1), unifColor(-1),
-      unifSampler2D(-1), unifTime(-1), unifDimensions(-1),
+      unifSampler2D(-1), unifTime(-1), unifPacked(-1), unifDimensions(-1),
       unifEye(-1),
       context(context)
 {}
@@ -68,6 +68,7 @@ void ShaderProgram::create(const char *vertfile, const char *fragfile)
     attrPos = context->glGetAttribLocation(prog, "vs_Pos");
     attrNor = context->glGetAttribLocation(prog, "vs_Nor");
     attrUV = context->glGetAttribLocation(prog, "vs_UV");
+    attrPacked = context->glGetAttribLocation(prog, "vs_Packed");
 
     unifModel      = context->glGetUniformLocation(prog, "u_Model");
     unifModelInvTr = context->glGetUniformLocation(prog, "u_ModelInvTr");
@@ -80,6 +81,7 @@ void ShaderProgram::create(const char *vertfile, const char *fragfile)
     // for texture
     unifSampler2D  = context->glGetUniformLocation(prog, "u_Texture");
     unifTime = context->glGetUniformLocation(prog, "u_Time");
+    unifPacked = context->glGetUniformLocation(prog, "u_Packed");
 }
 
 void ShaderProgram::createSnow(const char *vertfile, const char *fragfile)
@@ -296,6 +298,41 @@ void ShaderProgram::drawInterleaved(Drawable &d) {
     context->printGLErrorLog();
 }
 
+void ShaderProgram::enableInterleavedAttributes(bool packed) {
+    if(unifPacked != -1) {
+        context->glUniform1i(unifPacked, packed);
+    }
+    if (packed) {
+        if (attrPacked != -1) {
+            context->glEnableVertexAttribArray(attrPacked);
+            context->glVertexAttribIPointer(attrPacked, 2, GL_UNSIGNED_INT, sizeof(glm::uvec2), (void*)0);
+        }
+        return;
+    }
+
+    if (attrPos != -1) {
+        context->glEnableVertexAttribArray(attrPos);
+        context->glVertexAttribPointer(attrPos, 4, GL_FLOAT, false, 3 * sizeof(glm::vec4), (void*)0);
+    }
+
+    if (attrNor != -1) {
+        context->glEnableVertexAttribArray(attrNor);
+        context->glVertexAttribPointer(attrNor, 4, GL_FLOAT, false, 3 * sizeof(glm::vec4), (void*)sizeof(glm::vec4));
+    }
+
+    if (attrUV != -1) {
+        context->glEnableVertexAttribArray(attrUV);
+        context->glVertexAttribPointer(attrUV, 4, GL_FLOAT, false, 3 * sizeof(glm::vec4), (void*)(sizeof(glm::vec4) * 2));
+    }
+}
+
+void ShaderProgram::disableInterleavedAttributes() {
+    if (attrPos != -1) context->glDisableVertexAttribArray(attrPos);
+    if (attrNor != -1) context->glDisableVertexAttribArray(attrNor);
+    if (attrUV != -1) context->glDisableVertexAttribArray(attrUV);
+    if (attrPacked != -1) context->glDisableVertexAttribArray(attrPacked);
+}
+
 void ShaderProgram::drawTransparent(Drawable &d) {
     useMe();
     if(unifSampler2D != -1) {
@@ -310,28 +347,13 @@ void ShaderProgram::drawTransparent(Drawable &d) {
 
 
     if (d.bindInterleavedTrans()) {
-        if (attrPos != -1) {
-            context->glEnableVertexAttribArray(attrPos);
-            context->glVertexAttribPointer(attrPos, 4, GL_FLOAT, false, 3 * sizeof(glm::vec4), (void*)0);
-        }
-
-        if (attrNor != -1) {
-            context->glEnableVertexAttribArray(attrNor);
-            context->glVertexAttribPointer(attrNor, 4, GL_FLOAT, false, 3 * sizeof(glm::vec4), (void*)sizeof(glm::vec4));
-        }
-
-        if (attrUV != -1) {
-            context->glEnableVertexAttribArray(attrUV);
-            context->glVertexAttribPointer(attrUV, 4, GL_FLOAT, false, 3 * sizeof(glm::vec4), (void*)(sizeof(glm::vec4) * 2));
-        }
+        enableInterleavedAttributes(d.packedVertices());
     }
 
     d.bindIdxTrans();
     context->glDrawElements(d.drawMode(), d.elementTransCount(), GL_UNSIGNED_INT, 0);
 
-    if (attrPos != -1) context->glDisableVertexAttribArray(attrPos);
-    if (attrNor != -1) context->glDisableVertexAttribArray(attrNor);
-    if (attrUV != -1) context->glDisableVertexAttribArray(attrUV);
+    disableInterleavedAttributes();
 
     context->printGLErrorLog();
 
@@ -348,28 +370,13 @@ void ShaderProgram::drawOpaque(Drawable &d) {
     }
 
     if (d.bindInterleavedOpq()) {
-        if (attrPos != -1) {
-            context->glEnableVertexAttribArray(attrPos);
-            context->glVertexAttribPointer(attrPos, 4, GL_FLOAT, false, 3 * sizeof(glm::vec4), (void*)0);
-        }
-
-        if (attrNor != -1) {
-            context->glEnableVertexAttribArray(attrNor);
-            context->glVertexAttribPointer(attrNor, 4, GL_FLOAT, false, 3 * sizeof(glm::vec4), (void*)sizeof(glm::vec4));
-        }
-
-        if (attrUV != -1) {
-            context->glEnableVertexAttribArray(attrUV);
-            context->glVertexAttribPointer(attrUV, 4, GL_FLOAT, false, 3 * sizeof(glm::vec4), (void*)(sizeof(glm::vec4) * 2));
-        }
+        enableInterleavedAttributes(d.packedVertices());
     }
 
     d.bindIdxOpq();
     context->glDrawElements(d.drawMode(), d.elementOpqCount(), GL_UNSIGNED_INT, 0);
 
-    if (attrPos != -1) context->glDisableVertexAttribArray(attrPos);
-    if (attrNor != -1) context->glDisableVertexAttribArray(attrNor);
-    if (attrUV != -1) context->glDisableVertexAttribArray(attrUV);
+    disableInterleavedAttributes();
 
     context->printGLErrorLog();
 }
@@ -20,6 +20,7 @@ public:
     int attrNor; // A handle for the "in" vec4 representing vertex normal in the vertex shader
     int attrCol; // A handle for the "in" vec4 representing vertex color in the vertex shader
     int attrUV; // A handle for the "in" vec4 represent vertex uv in the vertex shader
+    int attrPacked; // A handle for the "in" uvec2 that replaces the three above for packed vertices
 
     int attrPosOffset; // A handle for a vec3 used only in the instanced rendering shader
 
@@ -30,6 +31,7 @@ public:
 
     int unifSampler2D;
     int unifTime;
+    int unifPacked; // Whether the vertex shader decodes attrPacked instead of reading attrPos, attrNor and attrUV
 
     //for sky
     int unifDimensions;
@@ -72,6 +74,11 @@ public:
     void setTime(int t);
 
 private:
+    // Points the vertex attributes at the bound interleaved VBO of
+    // drawTransparent or drawOpaque, laid out as packed says
+    void enableInterleavedAttributes(bool packed);
+    void disableInterleavedAttributes();
+
     OpenGLContext* context;   // Since Qt's OpenGL support is done through classes like QOpenGLFunctions_3_2_Core,
                             // we need to pass our OpenGL context to the Drawable in order to call GL functions
                             // from within this class.
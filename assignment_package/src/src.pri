@@ -6,9 +6,17 @@ SOURCES += \
     $$PWD/main.cpp \
     $$PWD/mainwindow.cpp \
     $$PWD/mygl.cpp \
-    $$PWD/scene/fbmworker.cpp \
+    $$PWD/scene/cavefield.cpp \
+    $$PWD/scene/decorator.cpp \
+    $$PWD/scene/generationpipeline.cpp \
+    $$PWD/scene/noise.cpp \
+    $$PWD/scene/noisebatch.cpp \
+    $$PWD/scene/palettedblocks.cpp \
     $$PWD/scene/quad.cpp \
+    $$PWD/scene/stageworker.cpp \
     $$PWD/scene/vboworker.cpp \
+    $$PWD/scene/worldfile.cpp \
+    $$PWD/scene/zonemap.cpp \
     $$PWD/shaderprogram.cpp \
     $$PWD/drawable.cpp \
     $$PWD/cameracontrolshelp.cpp \
@@ -21,6 +29,9 @@ SOURCES += \
     $$PWD/scene/camera.cpp \
     $$PWD/playerinfo.cpp \
     $$PWD/scene/chunk.cpp \
+    $$PWD/scene/chunkdirectory.cpp \
+    $$PWD/scene/chunkmap.cpp \
+    $$PWD/scene/chunkpool.cpp \
     $$PWD/simpledrawable.cpp \
     $$PWD/texture.cpp
 
@@ -29,9 +40,21 @@ HEADERS += \
     $$PWD/la.h \
     $$PWD/mainwindow.h \
     $$PWD/mygl.h \
-    $$PWD/scene/fbmworker.h \
+    $$PWD/scene/blocklayout.h \
+    $$PWD/scene/blockregistry.h \
+    $$PWD/scene/cavefield.h \
+    $$PWD/scene/decorator.h \
+    $$PWD/scene/generationpipeline.h \
+    $$PWD/scene/noise.h \
+    $$PWD/scene/noisegraph.h \
+    $$PWD/scene/noisekernel.inl \
+    $$PWD/scene/palettedblocks.h \
     $$PWD/scene/quad.h \
+    $$PWD/scene/stageworker.h \
+    $$PWD/scene/terrainnoise.h \
     $$PWD/scene/vboworker.h \
+    $$PWD/scene/worldfile.h \
+    $$PWD/scene/zonemap.h \
     $$PWD/shaderprogram.h \
     $$PWD/drawable.h \
     $$PWD/cameracontrolshelp.h \
@@ -47,4 +70,7 @@ HEADERS += \
     $$PWD/scene/camera.h \
     $$PWD/playerinfo.h \
     $$PWD/scene/chunk.h \
+    $$PWD/scene/chunkdirectory.h \
+    $$PWD/scene/chunkmap.h \
+    $$PWD/scene/chunkpool.h \
     $$PWD/texture.h